@@ -11,64 +11,1740 @@ namespace partIII
 // Transform a given vertex in clip-space [-w,w] to raster-space [0, {w|h}]
 #define TO_RASTER(v) glm::vec4((g_scWidth * (v.x + v.w) / 2), (g_scHeight * (v.w - v.y) / 2), v.z, v.w)
 
-    // Used for texture mapping
+    // Integer handle used to reference a material (its diffuse texture map for now) without string look-ups at draw time
+    using MaterialHandle = uint32_t;
+    static const MaterialHandle g_InvalidMaterial = UINT32_MAX;
+
+    // Size of the scratch memory reserved up front for each frame arena
+    static const auto g_FrameArenaSize = 4u * 1024u * 1024u;
+
+    // Number of frames to render, so that steady-state frames can be verified to not allocate
+    static const auto g_NumFrames = 2u;
+
+    // Memory budget for texture data kept resident by the texture cache, which applies to each render process on its own
+    static const auto g_TextureMemoryBudget = 256u * 1024u * 1024u;
+
+    // Number of processes each frame is rendered by, whose results are then composited by depth (sort-last). 1 renders in-process
+    static const auto g_NumRenderProcesses = 1u;
+
+    // How long (in milliseconds) a render process may take to reply before it's considered hung, and killed
+    static const auto g_RenderProcessTimeoutMs = 60000;
+
+    // Options of Part III which can be changed without recompiling, see main() for their command line switches
+    struct RenderSettings
+    {
+        uint32_t    m_NumRenderProcesses = g_NumRenderProcesses;
+
+        // Render the last frame once more in a single process and verify that compositing produced exactly the same output
+        bool        m_VerifyCompositing = false;
+    };
+
+    // Triangles with at most this many candidate pixels in their screen-space bounds go through the small-triangle kernel
+    static const auto g_SmallTriangleMaxSamples = 16u;
+
+    // How far (in pixels) projected vertices may lie beyond the screen for their edges to still be rasterized with 2D edge functions, which keeps
+    // raster-space coordinates small enough for float to resolve sub-pixel positions. Edges reaching further use homogeneous edge functions.
+    static const auto g_GuardBandSize = 1024.0f;
+
+    // How many triangles took each path in RasterizeTriangle() during a pass, see SubmitStats for which passes are counted together
+    struct RasterStats
+    {
+        uint64_t    m_NumNoSamples = 0ull;  // Rejected before any setup, as they don't cover any sample center
+        uint64_t    m_NumCulled = 0ull;     // Back-facing or degenerate
+        uint64_t    m_NumSmall = 0ull;      // Went through the small-triangle kernel
+        uint64_t    m_NumLarge = 0ull;      // Went through full setup
+
+        // Meshlets rejected as a whole before any VS invocations
+        uint64_t    m_NumMeshletsFrustumCulled = 0ull;
+        uint64_t    m_NumMeshletsConeCulled = 0ull;
+        uint64_t    m_NumMeshletsDrawn = 0ull;
+
+        RasterStats& operator+=(const RasterStats& other)
+        {
+            m_NumNoSamples += other.m_NumNoSamples;
+            m_NumCulled += other.m_NumCulled;
+            m_NumSmall += other.m_NumSmall;
+            m_NumLarge += other.m_NumLarge;
+            m_NumMeshletsFrustumCulled += other.m_NumMeshletsFrustumCulled;
+            m_NumMeshletsConeCulled += other.m_NumMeshletsConeCulled;
+            m_NumMeshletsDrawn += other.m_NumMeshletsDrawn;
+            return *this;
+        }
+
+        RasterStats& operator-=(const RasterStats& other)
+        {
+            m_NumNoSamples -= other.m_NumNoSamples;
+            m_NumCulled -= other.m_NumCulled;
+            m_NumSmall -= other.m_NumSmall;
+            m_NumLarge -= other.m_NumLarge;
+            m_NumMeshletsFrustumCulled -= other.m_NumMeshletsFrustumCulled;
+            m_NumMeshletsConeCulled -= other.m_NumMeshletsConeCulled;
+            m_NumMeshletsDrawn -= other.m_NumMeshletsDrawn;
+            return *this;
+        }
+    };
+
+    // Rasterization happens on a single thread per process, so plain counters are fine
+    static RasterStats g_RasterStats;
+
+    void PrintRasterStats(uint32_t frame, const char* pPassName, const RasterStats& stats)
+    {
+        printf("Frame %u: triangles rasterized in %s: %llu without samples, %llu culled, %llu small, %llu large\n", frame, pPassName,
+            static_cast<unsigned long long>(stats.m_NumNoSamples), static_cast<unsigned long long>(stats.m_NumCulled),
+            static_cast<unsigned long long>(stats.m_NumSmall), static_cast<unsigned long long>(stats.m_NumLarge));
+        printf("Frame %u: meshlets in %s: %llu frustum culled, %llu cone culled, %llu drawn\n", frame, pPassName,
+            static_cast<unsigned long long>(stats.m_NumMeshletsFrustumCulled), static_cast<unsigned long long>(stats.m_NumMeshletsConeCulled),
+            static_cast<unsigned long long>(stats.m_NumMeshletsDrawn));
+    }
+
+    // Counts heap allocations made through global operator new, which is replaced in RasterizationInOneWeekend.cpp
+    struct AllocationCounters
+    {
+        std::atomic<uint64_t> m_NumAllocs{ 0 };
+        std::atomic<uint64_t> m_NumBytes{ 0 };
+    };
+
+    static AllocationCounters g_AllocCounters;
+
+    // Counted counterparts of malloc(), realloc() & free() for memory that isn't allocated through operator new.
+    // stb_image allocates through these as well, see STBI_MALLOC in RasterizationInOneWeekend.cpp.
+    void* CountedMalloc(size_t size)
+    {
+        g_AllocCounters.m_NumAllocs++;
+        g_AllocCounters.m_NumBytes += size;
+
+        return malloc(size);
+    }
+
+    void* CountedRealloc(void* p, size_t size)
+    {
+        g_AllocCounters.m_NumAllocs++;
+        g_AllocCounters.m_NumBytes += size;
+
+        return realloc(p, size);
+    }
+
+    void CountedFree(void* p)
+    {
+        free(p);
+    }
+
+    // Used for texture mapping. Owns its image data, which is released back to stb_image upon destruction
     struct Texture
     {
+        Texture() = default;
+
+        ~Texture()
+        {
+            stbi_image_free(m_Data);
+        }
+
+        Texture(const Texture&) = delete;
+        Texture& operator=(const Texture&) = delete;
+
+        Texture(Texture&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        Texture& operator=(Texture&& other) noexcept
+        {
+            std::swap(m_Data, other.m_Data);
+            std::swap(m_Width, other.m_Width);
+            std::swap(m_Height, other.m_Height);
+            std::swap(m_NumChannels, other.m_NumChannels);
+            return *this;
+        }
+
         stbi_uc*    m_Data = nullptr;
         int32_t     m_Width = -1;
         int32_t     m_Height = -1;
         int32_t     m_NumChannels = -1;
     };
 
-    // Vertex data to be fed into each VS invocation as input
-    struct VertexInput
+    // Replace contents of a texture with its next mip level by box-filtering 2x2 texel footprints
+    void GenerateNextMip(Texture& texture)
+    {
+        const int32_t srcWidth = texture.m_Width;
+        const int32_t srcHeight = texture.m_Height;
+        const int32_t numChannels = texture.m_NumChannels;
+
+        const int32_t width = std::max(1, srcWidth / 2);
+        const int32_t height = std::max(1, srcHeight / 2);
+
+        // Allocated the same way as stb_image does, as the texture releases its data through stbi_image_free()
+        stbi_uc* pMip = static_cast<stbi_uc*>(CountedMalloc(static_cast<size_t>(width) * height * numChannels));
+        assert(pMip != nullptr);
+
+        for (int32_t y = 0; y < height; y++)
+        {
+            // Clamp footprints at the last row & column of odd-sized textures
+            const int32_t y0 = std::min(2 * y, srcHeight - 1);
+            const int32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+
+            for (int32_t x = 0; x < width; x++)
+            {
+                const int32_t x0 = std::min(2 * x, srcWidth - 1);
+                const int32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+
+                for (int32_t c = 0; c < numChannels; c++)
+                {
+                    uint32_t sum =
+                        texture.m_Data[(y0 * srcWidth + x0) * numChannels + c] +
+                        texture.m_Data[(y0 * srcWidth + x1) * numChannels + c] +
+                        texture.m_Data[(y1 * srcWidth + x0) * numChannels + c] +
+                        texture.m_Data[(y1 * srcWidth + x1) * numChannels + c];
+
+                    pMip[(y * width + x) * numChannels + c] = static_cast<stbi_uc>((sum + 2) / 4);
+                }
+            }
+        }
+
+        stbi_image_free(texture.m_Data);
+
+        texture.m_Data = pMip;
+        texture.m_Width = width;
+        texture.m_Height = height;
+    }
+
+    struct TextureCacheStats
+    {
+        uint64_t    m_NumHits = 0ull;
+        uint64_t    m_NumMisses = 0ull;
+        uint64_t    m_NumEvictions = 0ull;
+        uint64_t    m_NumDownsampled = 0ull;    // Textures loaded at or moved to a coarser mip level to fit the working set in budget
+        uint64_t    m_NumRefined = 0ull;        // Textures reloaded at a finer mip level once the working set shrank
+        uint64_t    m_NumFailed = 0ull;         // Textures which failed to load and are drawn with a placeholder instead
+        size_t      m_PeakBytesResident = 0;
+    };
+
+    void PrintTextureCacheStats(const char* pName, const TextureCacheStats& stats, size_t bytesResident, size_t budget)
+    {
+        printf("Texture cache%s%s: %llu hits, %llu misses, %llu evictions, %llu downsampled, %llu refined, %llu failed, %zu bytes resident (peak %zu), budget %zu bytes\n",
+            (pName != nullptr) ? " of " : "", (pName != nullptr) ? pName : "",
+            static_cast<unsigned long long>(stats.m_NumHits), static_cast<unsigned long long>(stats.m_NumMisses),
+            static_cast<unsigned long long>(stats.m_NumEvictions), static_cast<unsigned long long>(stats.m_NumDownsampled),
+            static_cast<unsigned long long>(stats.m_NumRefined), static_cast<unsigned long long>(stats.m_NumFailed),
+            bytesResident, stats.m_PeakBytesResident, budget);
+    }
+
+    // Streams textures in on demand and keeps them resident in LRU order under a fixed memory budget.
+    // Textures are referenced by material handles, whose texture data is only decoded the first time they're acquired.
+    // Mip levels are picked by the working set of the previous frame: if it didn't fit in budget at full resolution, every texture
+    // is kept at the finest level which fits its share of the budget, in proportion to its full size. Frames drawing the same textures
+    // as the previous one therefore settle on the same mip levels and hit in cache, instead of evicting each other over and over again.
+    struct TextureCache
+    {
+        explicit TextureCache(size_t budget) :
+            m_Budget(budget)
+        {
+            // Single mid-grey texel drawn in place of textures which fail to load
+            m_Placeholder.m_Data = static_cast<stbi_uc*>(CountedMalloc(3));
+            m_Placeholder.m_Width = 1;
+            m_Placeholder.m_Height = 1;
+            m_Placeholder.m_NumChannels = 3;
+            memset(m_Placeholder.m_Data, 128, 3);
+        }
+
+        // Add a texture to be streamed in later on; nothing is loaded yet
+        MaterialHandle Register(const std::string& fileName)
+        {
+            m_Entries.emplace_back();
+            m_Entries.back().m_FileName = fileName;
+
+            return static_cast<MaterialHandle>(m_Entries.size() - 1);
+        }
+
+        // Textures used during the previous frame make up the working set that mip levels of this frame are picked by
+        void BeginFrame()
+        {
+            m_FrameIdx++;
+            m_WorkingSetBytes = m_BytesUsedThisFrame;
+            m_BytesUsedThisFrame = 0;
+        }
+
+        // Return resident texture of given material, loading it if needed. Returned texture stays valid until the next Acquire()
+        Texture* Acquire(MaterialHandle handle)
+        {
+            Entry& entry = m_Entries[handle];
+            if (entry.m_Failed)
+                return &m_Placeholder;
+
+            const bool firstUseThisFrame = (entry.m_LastUsedFrame != m_FrameIdx);
+            entry.m_LastUsedFrame = m_FrameIdx;
+
+            if (entry.m_Texture.m_Data != nullptr)
+            {
+                m_Stats.m_NumHits++;
+
+                Unlink(handle);
+                LinkFront(handle);
+
+                // Working set may have changed since texture was loaded, so move it to the mip level called for now
+                if (firstUseThisFrame)
+                {
+                    m_BytesUsedThisFrame += GetMipSize(handle, 0u);
+
+                    const uint32_t mipLevel = GetTargetMipLevel(handle);
+                    if (mipLevel > entry.m_MipLevel)
+                        Downsample(handle, mipLevel);
+                    else if (mipLevel < entry.m_MipLevel)
+                        Refine(handle, mipLevel);
+                }
+
+                return &entry.m_Texture;
+            }
+
+            m_Stats.m_NumMisses++;
+
+            Texture texture;
+            texture.m_Data = stbi_load(entry.m_FileName.c_str(), &texture.m_Width, &texture.m_Height, &texture.m_NumChannels, 0);
+            if (texture.m_Data == nullptr)
+            {
+                printf("WARNING: Failed to load %s, drawing a placeholder instead\n", entry.m_FileName.c_str());
+
+                entry.m_Failed = true;
+                m_Stats.m_NumFailed++;
+
+                return &m_Placeholder;
+            }
+
+            entry.m_BaseWidth = texture.m_Width;
+            entry.m_BaseHeight = texture.m_Height;
+            entry.m_NumChannels = texture.m_NumChannels;
+
+            if (firstUseThisFrame)
+                m_BytesUsedThisFrame += GetSize(texture);
+
+            uint32_t mipLevel = GetTargetMipLevel(handle);
+            for (uint32_t i = 0u; i < mipLevel; i++)
+                GenerateNextMip(texture);
+
+            // First make room by evicting textures that haven't been used during this frame, least recently used first
+            while (!Fits(texture) && (m_LRUTail != g_InvalidMaterial) && (m_Entries[m_LRUTail].m_LastUsedFrame != m_FrameIdx))
+                Evict(m_LRUTail);
+
+            // Evict textures of this frame as well if needed, which only happens while the working set isn't known yet or has grown
+            while (!Fits(texture) && (m_LRUTail != g_InvalidMaterial))
+                Evict(m_LRUTail);
+
+            // A single texture exceeding the whole budget has to settle for a coarser mip level regardless
+            while (!Fits(texture) && ((texture.m_Width > 1) || (texture.m_Height > 1)))
+            {
+                GenerateNextMip(texture);
+                mipLevel++;
+            }
+
+            m_Stats.m_NumDownsampled += (mipLevel > 0u) ? 1u : 0u;
+
+            m_BytesResident += GetSize(texture);
+            m_Stats.m_PeakBytesResident = std::max(m_Stats.m_PeakBytesResident, m_BytesResident);
+
+            entry.m_Texture = std::move(texture);
+            entry.m_MipLevel = mipLevel;
+            LinkFront(handle);
+
+            return &entry.m_Texture;
+        }
+
+        // Finest mip level of a loaded texture which fits its share of the budget, given the working set of the previous frame
+        uint32_t GetTargetMipLevel(MaterialHandle handle) const
+        {
+            uint32_t mipLevel = 0u;
+            if (m_WorkingSetBytes > m_Budget)
+            {
+                const double share = static_cast<double>(GetMipSize(handle, 0u)) * m_Budget / m_WorkingSetBytes;
+                while ((GetMipSize(handle, mipLevel) > share) && (GetMipSize(handle, mipLevel + 1u) < GetMipSize(handle, mipLevel)))
+                    mipLevel++;
+            }
+
+            return mipLevel;
+        }
+
+        // Move a resident texture to a coarser mip level in place
+        void Downsample(MaterialHandle handle, uint32_t mipLevel)
+        {
+            Entry& entry = m_Entries[handle];
+
+            m_BytesResident -= GetSize(entry.m_Texture);
+            for (uint32_t i = entry.m_MipLevel; i < mipLevel; i++)
+                GenerateNextMip(entry.m_Texture);
+            m_BytesResident += GetSize(entry.m_Texture);
+
+            entry.m_MipLevel = mipLevel;
+            m_Stats.m_NumDownsampled++;
+        }
+
+        // Reload a resident texture at a finer mip level, as close to the given one as fits in budget. Only textures outside of the
+        // working set, i.e. used during neither this nor the previous frame, are evicted to make room. Otherwise current copy is kept.
+        void Refine(MaterialHandle handle, uint32_t targetMipLevel)
+        {
+            Entry& entry = m_Entries[handle];
+            const size_t currentSize = GetSize(entry.m_Texture);
+
+            size_t available = m_Budget - std::min(m_Budget, m_BytesResident - currentSize);
+            for (MaterialHandle stale = m_LRUTail; (stale != g_InvalidMaterial) && IsStale(stale); stale = m_Entries[stale].m_Prev)
+                available += GetSize(m_Entries[stale].m_Texture);
+
+            uint32_t mipLevel = targetMipLevel;
+            while ((mipLevel < entry.m_MipLevel) && (GetMipSize(handle, mipLevel) > available))
+                mipLevel++;
+
+            if (mipLevel == entry.m_MipLevel)
+                return;
+
+            Texture texture;
+            texture.m_Data = stbi_load(entry.m_FileName.c_str(), &texture.m_Width, &texture.m_Height, &texture.m_NumChannels, 0);
+            if (texture.m_Data == nullptr)
+                return;
+
+            for (uint32_t i = 0u; i < mipLevel; i++)
+                GenerateNextMip(texture);
+
+            m_BytesResident -= currentSize;
+            while (!Fits(texture) && (m_LRUTail != g_InvalidMaterial) && IsStale(m_LRUTail))
+                Evict(m_LRUTail);
+
+            m_BytesResident += GetSize(texture);
+            m_Stats.m_PeakBytesResident = std::max(m_Stats.m_PeakBytesResident, m_BytesResident);
+            m_Stats.m_NumRefined++;
+
+            entry.m_Texture = std::move(texture);
+            entry.m_MipLevel = mipLevel;
+        }
+
+        // Name tells caches of multiple processes apart, if any
+        void PrintStats(const char* pName) const
+        {
+            PrintTextureCacheStats(pName, m_Stats, m_BytesResident, m_Budget);
+        }
+
+        static size_t GetSize(const Texture& texture)
+        {
+            return static_cast<size_t>(texture.m_Width) * texture.m_Height * texture.m_NumChannels;
+        }
+
+        // Size of given mip level of a texture which has been loaded before, following the dimensions GenerateNextMip() produces
+        size_t GetMipSize(MaterialHandle handle, uint32_t mipLevel) const
+        {
+            const Entry& entry = m_Entries[handle];
+
+            int32_t width = entry.m_BaseWidth;
+            int32_t height = entry.m_BaseHeight;
+            for (uint32_t i = 0u; i < mipLevel; i++)
+            {
+                width = std::max(1, width / 2);
+                height = std::max(1, height / 2);
+            }
+
+            return static_cast<size_t>(width) * height * entry.m_NumChannels;
+        }
+
+        // Not part of the working set, as it was used during neither this nor the previous frame
+        bool IsStale(MaterialHandle handle) const
+        {
+            return ((m_Entries[handle].m_LastUsedFrame + 1ull) < m_FrameIdx);
+        }
+
+        bool Fits(const Texture& texture) const
+        {
+            return (m_BytesResident + GetSize(texture)) <= m_Budget;
+        }
+
+        void Evict(MaterialHandle handle)
+        {
+            Entry& entry = m_Entries[handle];
+
+            Unlink(handle);
+            m_BytesResident -= GetSize(entry.m_Texture);
+            m_Stats.m_NumEvictions++;
+
+            // Releases texture data
+            entry.m_Texture = Texture();
+        }
+
+        void LinkFront(MaterialHandle handle)
+        {
+            Entry& entry = m_Entries[handle];
+            entry.m_Prev = g_InvalidMaterial;
+            entry.m_Next = m_LRUHead;
+
+            if (m_LRUHead != g_InvalidMaterial)
+                m_Entries[m_LRUHead].m_Prev = handle;
+            else
+                m_LRUTail = handle;
+
+            m_LRUHead = handle;
+        }
+
+        void Unlink(MaterialHandle handle)
+        {
+            Entry& entry = m_Entries[handle];
+
+            if (entry.m_Prev != g_InvalidMaterial)
+                m_Entries[entry.m_Prev].m_Next = entry.m_Next;
+            else
+                m_LRUHead = entry.m_Next;
+
+            if (entry.m_Next != g_InvalidMaterial)
+                m_Entries[entry.m_Next].m_Prev = entry.m_Prev;
+            else
+                m_LRUTail = entry.m_Prev;
+
+            entry.m_Prev = entry.m_Next = g_InvalidMaterial;
+        }
+
+        struct Entry
+        {
+            std::string     m_FileName;
+            Texture         m_Texture;  // Not resident if m_Data is null
+            uint32_t        m_MipLevel = 0u;
+            int32_t         m_BaseWidth = -1;   // Mip level 0, known once loaded
+            int32_t         m_BaseHeight = -1;
+            int32_t         m_NumChannels = -1;
+            uint64_t        m_LastUsedFrame = 0ull;
+            bool            m_Failed = false;   // Failed to load, not retried
+
+            // Intrusive LRU list links, most recently used at head
+            MaterialHandle  m_Prev = g_InvalidMaterial;
+            MaterialHandle  m_Next = g_InvalidMaterial;
+        };
+
+        std::vector<Entry>  m_Entries;
+        MaterialHandle      m_LRUHead = g_InvalidMaterial;
+        MaterialHandle      m_LRUTail = g_InvalidMaterial;
+        size_t              m_Budget = 0;
+        size_t              m_BytesResident = 0;
+        uint64_t            m_FrameIdx = 0ull;
+        size_t              m_WorkingSetBytes = 0;      // Full-resolution size of textures used during the previous frame
+        size_t              m_BytesUsedThisFrame = 0;   // Full-resolution size of textures used so far during this frame
+        Texture             m_Placeholder;
+        TextureCacheStats   m_Stats;
+    };
+
+    // Linear allocator handing out scratch memory from a single block reserved up front.
+    // Nothing is freed individually; all allocations are released at once by Reset(), e.g. at the start of every frame.
+    struct LinearArena
+    {
+        explicit LinearArena(size_t capacity) :
+            m_pBase(new uint8_t[capacity]),
+            m_Capacity(capacity)
+        {
+        }
+
+        template<typename T>
+        T* Alloc(size_t count)
+        {
+            // Objects are never destructed, so only allow types that don't need it
+            static_assert(std::is_trivially_destructible<T>::value, "Arena allocations are never destructed!");
+
+            size_t offset = (m_Used + alignof(T) - 1) & ~(alignof(T) - 1);
+            if ((offset + count * sizeof(T)) > m_Capacity)
+            {
+                assert(false && "Frame arena is out of memory!");
+                return nullptr;
+            }
+
+            m_Used = offset + count * sizeof(T);
+            m_HighWater = std::max(m_HighWater, m_Used);
+
+            return reinterpret_cast<T*>(m_pBase.get() + offset);
+        }
+
+        void Reset()
+        {
+            m_Used = 0;
+        }
+
+        std::unique_ptr<uint8_t[]>  m_pBase;
+        size_t                      m_Capacity = 0;
+        size_t                      m_Used = 0;
+        size_t                      m_HighWater = 0; // Peak usage, useful for sizing arenas
+    };
+
+    // Persistent worker threads, so that dispatching work every frame doesn't create threads (and allocate) over and over again
+    struct WorkerPool
+    {
+        explicit WorkerPool(uint32_t numWorkers)
+        {
+            for (uint32_t i = 0; i < numWorkers; i++)
+                m_Threads.emplace_back(&WorkerPool::WorkerMain, this, i);
+        }
+
+        ~WorkerPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Quit = true;
+            }
+            m_WorkCV.notify_all();
+
+            for (std::thread& thread : m_Threads)
+                thread.join();
+        }
+
+        uint32_t GetNumWorkers() const
+        {
+            return static_cast<uint32_t>(m_Threads.size());
+        }
+
+        // Invoke job(workerIdx) on every worker and wait until all of them are done.
+        // Job is only referenced through a plain function pointer, hence no std::function (or heap allocation) is involved.
+        template<typename Job>
+        void Run(Job& job)
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+
+            m_pJob = &job;
+            m_pfnInvoke = [](void* pJob, uint32_t workerIdx) { (*static_cast<Job*>(pJob))(workerIdx); };
+            m_NumPending = GetNumWorkers();
+            m_Generation++;
+            m_WorkCV.notify_all();
+
+            m_DoneCV.wait(lock, [this]() { return m_NumPending == 0; });
+        }
+
+        void WorkerMain(uint32_t workerIdx)
+        {
+            uint64_t lastGeneration = 0;
+            for (;;)
+            {
+                void* pJob = nullptr;
+                void (*pfnInvoke)(void*, uint32_t) = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(m_Mutex);
+                    m_WorkCV.wait(lock, [&]() { return m_Quit || (m_Generation != lastGeneration); });
+                    if (m_Quit)
+                        return;
+
+                    lastGeneration = m_Generation;
+                    pJob = m_pJob;
+                    pfnInvoke = m_pfnInvoke;
+                }
+
+                pfnInvoke(pJob, workerIdx);
+
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    if (--m_NumPending == 0)
+                        m_DoneCV.notify_one();
+                }
+            }
+        }
+
+        std::vector<std::thread>    m_Threads;
+        std::mutex                  m_Mutex;
+        std::condition_variable     m_WorkCV;
+        std::condition_variable     m_DoneCV;
+        void*                       m_pJob = nullptr;
+        void                        (*m_pfnInvoke)(void*, uint32_t) = nullptr;
+        uint32_t                    m_NumPending = 0u;
+        uint64_t                    m_Generation = 0ull;
+        bool                        m_Quit = false;
+    };
+
+    // Vertex data to be fed into each VS invocation as input
+    struct VertexInput
+    {
+        glm::vec3   Pos;
+        glm::vec3   Normal;
+        glm::vec2   TexCoords;
+    };
+
+    // Vertex Shader payload, which will be passed to each FS invocation as input
+    struct FragmentInput
+    {
+        glm::vec3   Normal;
+        glm::vec2   TexCoords;
+    };
+
+    // Indexed mesh
+    struct Mesh
+    {
+        // Offset into the global index buffer
+        uint32_t    m_IdxOffset = 0u;
+
+        // How many indices this mesh contains. Number of triangles therefore equals (m_IdxCount / 3)
+        uint32_t    m_IdxCount = 0u;
+
+        // Handle of the material to be used, resolved from the diffuse texture name of the .OBJ material once at load time
+        MaterialHandle m_Material = g_InvalidMaterial;
+
+        // Object-space bounding box of all vertices referenced by the mesh
+        glm::vec3   m_BoundsMin = glm::vec3(FLT_MAX);
+        glm::vec3   m_BoundsMax = glm::vec3(-FLT_MAX);
+
+        // Range of meshlets in the scene's meshlet data the mesh is split into, which is what's actually drawn
+        uint32_t    m_MeshletOffset = 0u;
+        uint32_t    m_MeshletCount = 0u;
+    };
+
+    // Upper limits of meshlet sizes; local vertex indices of meshlet triangles have to fit in 8 bits
+    static const auto g_MeshletMaxVertices = 64u;
+    static const auto g_MeshletMaxTriangles = 124u;
+
+    // Cluster of up to g_MeshletMaxVertices vertices and g_MeshletMaxTriangles triangles of a mesh, along with the bounds to cull it as a whole
+    struct Meshlet
+    {
+        // Offset into meshlet vertices, which index into the global vertex buffer
+        uint32_t    m_VertexOffset = 0u;
+        uint32_t    m_VertexCount = 0u;
+
+        // Offset into meshlet triangles, which store 3 local vertex indices (relative to m_VertexOffset) per triangle
+        uint32_t    m_TriangleOffset = 0u;
+        uint32_t    m_TriangleCount = 0u;
+
+        // Object-space bounding sphere for frustum culling
+        glm::vec3   m_Center;
+        float       m_Radius = 0.f;
+
+        // Normal cone for backface culling. Meshlet is entirely back-facing if dot(normalize(m_ConeApex - eye), m_ConeAxis) > m_ConeCutoff
+        // Cutoff of 1 (or above) means that the cone is too wide to ever cull the meshlet
+        glm::vec3   m_ConeApex;
+        glm::vec3   m_ConeAxis;
+        float       m_ConeCutoff = 1.f;
+    };
+
+    // Meshlets of all meshes in the scene
+    struct MeshletData
+    {
+        std::vector<Meshlet>    m_Meshlets;
+        std::vector<uint32_t>   m_Vertices;
+        std::vector<uint8_t>    m_Triangles;
+    };
+
+    // Single recorded draw, which is only executed when its command buffer is submitted
+    struct DrawCommand
+    {
+        // Index of the mesh to draw into the scene's mesh buffer
+        uint32_t        m_MeshIdx = 0u;
+
+        // Material to shade the mesh with
+        MaterialHandle  m_Material = g_InvalidMaterial;
+
+        // Object-space to clip-space transform
+        glm::mat4       m_MVP;
+    };
+
+    // Order in which recorded draws are executed at submit time
+    enum class SortMode
+    {
+        None,           // Keep recording order
+        Material,       // Group draws by material so that the same texture stays hot in cache, front-to-back within a material
+        FrontToBack     // Sort draws by view depth of their mesh centers to reject occluded fragments early
+    };
+
+    struct SubmitOptions
+    {
+        SortMode    m_SortMode = SortMode::None;
+
+        // Lay down depth of all draws in a depth-only pass first, so that only visible fragments are shaded afterwards
+        bool        m_DepthPrepass = false;
+
+        // Skip draws whose bounding boxes are entirely occluded by what's already in the depth buffer
+        bool        m_OcclusionCulling = false;
+    };
+
+    struct SubmitStats
+    {
+        uint32_t    m_NumDraws = 0u;
+        uint32_t    m_NumOccluded = 0u;
+
+        // Shading pass is counted apart from depth-only passes, which rasterize every visible triangle once more and 12 triangles
+        // of bounding boxes for each occlusion query
+        RasterStats m_RasterStats;          // Shading pass
+        RasterStats m_DepthOnlyRasterStats; // Depth pre-pass and occlusion queries
+
+        // Heap allocations made by render processes for this submission, see SubmitMultiProcess(). Those of the submitting process are in g_AllocCounters.
+        uint64_t    m_NumChildAllocs = 0ull;
+        uint64_t    m_NumChildAllocBytes = 0ull;
+    };
+
+    // Draws are recorded into command buffers and executed later on by Submit().
+    // Each recording thread should use its own command buffer, as recording isn't synchronized.
+    // Commands are stored in the recording thread's frame arena, so they're only valid until that arena is reset.
+    struct CommandBuffer
+    {
+        void Begin(LinearArena& arena, uint32_t maxDraws)
+        {
+            m_pCommands = arena.Alloc<DrawCommand>(maxDraws);
+            m_MaxCommands = maxDraws;
+            m_NumCommands = 0u;
+        }
+
+        void RecordDraw(uint32_t meshIdx, const glm::mat4& MVP, MaterialHandle material)
+        {
+            assert((m_NumCommands < m_MaxCommands) && "Command buffer is full!");
+
+            DrawCommand& cmd = m_pCommands[m_NumCommands++];
+            cmd.m_MeshIdx = meshIdx;
+            cmd.m_Material = material;
+            cmd.m_MVP = MVP;
+        }
+
+        DrawCommand*    m_pCommands = nullptr;
+        uint32_t        m_MaxCommands = 0u;
+        uint32_t        m_NumCommands = 0u;
+    };
+
+    void DrawIndexed(std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, Mesh& mesh, glm::mat4& MVP, TextureCache& textureCache, MaterialHandle material);
+
+    void DrawIndexedDepthOnly(std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, Mesh& mesh, glm::mat4& MVP);
+
+    uint32_t OcclusionQuery(std::vector<float>& depthBuffer, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& MVP, bool earlyOut);
+
+    // Map a float to an unsigned integer whose ordering matches the ordering of floats so that it can be used in sort keys
+    uint32_t FloatToSortableUInt(float f)
+    {
+        uint32_t bits = 0u;
+        memcpy(&bits, &f, sizeof(float));
+
+        // Flip all bits of negative values to reverse their order, and only the sign bit of positive ones to move them above negatives
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    // Sort entry referencing a recorded draw command
+    struct SortEntry
+    {
+        uint64_t            m_Key;
+        const DrawCommand*  m_pCmd;
+        uint32_t            m_Seq; // Position in recording order, breaks ties so that execution order is deterministic
+    };
+
+    // Gather draws of all command buffers and sort them in execution order. Returned entries live in the frame arena.
+    SortEntry* SortDraws(const std::vector<CommandBuffer>& cmdBuffers, SortMode sortMode, LinearArena& frameArena, std::vector<Mesh>& meshBuffer, uint32_t& numEntries)
+    {
+        uint32_t cmdCount = 0u;
+        for (const CommandBuffer& cmdBuffer : cmdBuffers)
+            cmdCount += cmdBuffer.m_NumCommands;
+
+        // Sort entries are only needed during this submission, so grab them from the frame arena
+        SortEntry* pEntries = frameArena.Alloc<SortEntry>(cmdCount);
+        numEntries = 0u;
+
+        // Command buffers are concatenated in the order they're passed in, regardless of which thread recorded them
+        for (const CommandBuffer& cmdBuffer : cmdBuffers)
+        {
+            for (uint32_t i = 0; i < cmdBuffer.m_NumCommands; i++)
+            {
+                const DrawCommand& cmd = cmdBuffer.m_pCommands[i];
+                const Mesh& mesh = meshBuffer[cmd.m_MeshIdx];
+
+                // View depth of mesh center is simply its clip-space w
+                glm::vec3 center = (mesh.m_BoundsMin + mesh.m_BoundsMax) * 0.5f;
+                float depth = (cmd.m_MVP * glm::vec4(center, 1.0f)).w;
+
+                uint64_t key = 0ull;
+                switch (sortMode)
+                {
+                case SortMode::Material:
+                    key = (static_cast<uint64_t>(cmd.m_Material) << 32) | FloatToSortableUInt(depth);
+                    break;
+                case SortMode::FrontToBack:
+                    key = (static_cast<uint64_t>(FloatToSortableUInt(depth)) << 32) | cmd.m_Material;
+                    break;
+                default:
+                    break;
+                }
+
+                pEntries[numEntries] = { key, &cmd, numEntries };
+                numEntries++;
+            }
+        }
+
+        // Keys are made unique by the sequence number, so an in-place (non-allocating) unstable sort is fine
+        std::sort(pEntries, pEntries + numEntries, [](const SortEntry& a, const SortEntry& b)
+        {
+            return (a.m_Key != b.m_Key) ? (a.m_Key < b.m_Key) : (a.m_Seq < b.m_Seq);
+        });
+
+        return pEntries;
+    }
+
+    // Execute given range of sorted draws
+    SubmitStats ExecuteDraws(const SortEntry* pEntries, uint32_t numEntries, const SubmitOptions& options, std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, std::vector<Mesh>& meshBuffer, TextureCache& textureCache)
+    {
+        const RasterStats rasterStatsBefore = g_RasterStats;
+
+        SubmitStats stats;
+        stats.m_NumDraws = numEntries;
+
+        if (options.m_DepthPrepass)
+        {
+            for (uint32_t i = 0; i < numEntries; i++)
+            {
+                const DrawCommand& cmd = *pEntries[i].m_pCmd;
+
+                glm::mat4 MVP = cmd.m_MVP;
+                DrawIndexedDepthOnly(depthBuffer, vertexBuffer, meshletData, meshBuffer[cmd.m_MeshIdx], MVP);
+            }
+        }
+
+        // Execute draws in sorted order
+        for (uint32_t i = 0; i < numEntries; i++)
+        {
+            const DrawCommand& cmd = *pEntries[i].m_pCmd;
+            Mesh& mesh = meshBuffer[cmd.m_MeshIdx];
+
+            // A single visible sample is enough to draw the mesh, so let the query bail out early
+            if (options.m_OcclusionCulling && (OcclusionQuery(depthBuffer, mesh.m_BoundsMin, mesh.m_BoundsMax, cmd.m_MVP, true /*earlyOut*/) == 0u))
+            {
+                stats.m_NumOccluded++;
+                continue;
+            }
+
+            const RasterStats shadingStatsBefore = g_RasterStats;
+
+            glm::mat4 MVP = cmd.m_MVP;
+            DrawIndexed(frameBuffer, depthBuffer, vertexBuffer, meshletData, mesh, MVP, textureCache, cmd.m_Material);
+
+            stats.m_RasterStats += g_RasterStats;
+            stats.m_RasterStats -= shadingStatsBefore;
+        }
+
+        // Whatever else was rasterized during this submission belongs to depth-only passes
+        stats.m_DepthOnlyRasterStats = g_RasterStats;
+        stats.m_DepthOnlyRasterStats -= rasterStatsBefore;
+        stats.m_DepthOnlyRasterStats -= stats.m_RasterStats;
+
+        return stats;
+    }
+
+    SubmitStats Submit(const std::vector<CommandBuffer>& cmdBuffers, const SubmitOptions& options, LinearArena& frameArena, std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, std::vector<Mesh>& meshBuffer, TextureCache& textureCache)
+    {
+        uint32_t numEntries = 0u;
+        SortEntry* pEntries = SortDraws(cmdBuffers, options.m_SortMode, frameArena, meshBuffer, numEntries);
+
+        return ExecuteDraws(pEntries, numEntries, options, frameBuffer, depthBuffer, vertexBuffer, meshletData, meshBuffer, textureCache);
+    }
+
+    // What a render process reports back about the partition it last rendered
+    struct PartitionStats
+    {
+        SubmitStats         m_Submit;
+
+        // Texture cache of the render process, which persists across frames
+        TextureCacheStats   m_TextureCache;
+        size_t              m_TextureBytesResident = 0;
+        size_t              m_TextureBudget = 0;
+    };
+
+    // Everything the submitting process shares with render processes: submit options & sorted draws of the current frame, how they're
+    // partitioned, and color & depth buffers plus stats of every partition. Allocated once up front and reused every frame.
+    struct CompositingBuffers
+    {
+        CompositingBuffers(uint32_t numPartitions, uint32_t maxDraws) :
+            m_NumPartitions(numPartitions),
+            m_MaxDraws(maxDraws)
+        {
+            auto alignUp = [](size_t offset) { return (offset + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1); };
+
+            m_PartitionBeginOffset = alignUp(sizeof(SubmitOptions));
+            m_StatsOffset = alignUp(m_PartitionBeginOffset + sizeof(uint32_t) * (numPartitions + 1));
+            m_DrawsOffset = alignUp(m_StatsOffset + sizeof(PartitionStats) * numPartitions);
+            m_ColorOffset = alignUp(m_DrawsOffset + sizeof(DrawCommand) * maxDraws);
+            m_DepthOffset = alignUp(m_ColorOffset + sizeof(glm::vec3) * g_scWidth * g_scHeight * numPartitions);
+            m_Size = m_DepthOffset + sizeof(float) * g_scWidth * g_scHeight * numPartitions;
+
+#if defined(__linux__)
+            // Anonymous shared mapping stays shared with all processes fork()'ed off later on
+            void* pMemory = mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            assert((pMemory != MAP_FAILED) && "Failed to map shared memory!");
+#else
+            // Partitions are rendered in-process without fork(), so plain memory is just fine
+            void* pMemory = CountedMalloc(m_Size);
+            assert((pMemory != nullptr) && "Failed to allocate compositing buffers!");
+            memset(pMemory, 0, m_Size);
+#endif
+            m_pMemory = static_cast<uint8_t*>(pMemory);
+
+            for (uint32_t p = 0; p < numPartitions; p++)
+                new (GetStats(p)) PartitionStats();
+        }
+
+        ~CompositingBuffers()
+        {
+#if defined(__linux__)
+            munmap(m_pMemory, m_Size);
+#else
+            CountedFree(m_pMemory);
+#endif
+        }
+
+        CompositingBuffers(const CompositingBuffers&) = delete;
+        CompositingBuffers& operator=(const CompositingBuffers&) = delete;
+
+        SubmitOptions* GetOptions()
+        {
+            return reinterpret_cast<SubmitOptions*>(m_pMemory);
+        }
+
+        // First sorted draw of each partition, plus one past the last draw
+        uint32_t* GetPartitionBegin()
+        {
+            return reinterpret_cast<uint32_t*>(m_pMemory + m_PartitionBeginOffset);
+        }
+
+        PartitionStats* GetStats(uint32_t partition)
+        {
+            return reinterpret_cast<PartitionStats*>(m_pMemory + m_StatsOffset) + partition;
+        }
+
+        // Draws of the current frame in sorted order
+        DrawCommand* GetDraws()
+        {
+            return reinterpret_cast<DrawCommand*>(m_pMemory + m_DrawsOffset);
+        }
+
+        glm::vec3* GetColor(uint32_t partition)
+        {
+            return reinterpret_cast<glm::vec3*>(m_pMemory + m_ColorOffset) + partition * g_scWidth * g_scHeight;
+        }
+
+        float* GetDepth(uint32_t partition)
+        {
+            return reinterpret_cast<float*>(m_pMemory + m_DepthOffset) + partition * g_scWidth * g_scHeight;
+        }
+
+        uint8_t*    m_pMemory = nullptr;
+        size_t      m_Size = 0;
+        size_t      m_PartitionBeginOffset = 0;
+        size_t      m_StatsOffset = 0;
+        size_t      m_DrawsOffset = 0;
+        size_t      m_ColorOffset = 0;
+        size_t      m_DepthOffset = 0;
+        uint32_t    m_NumPartitions = 0u;
+        uint32_t    m_MaxDraws = 0u;
+    };
+
+    // Render a single partition of sorted draws and store its color & depth in the compositing buffers.
+    // Given frame & depth buffers are only used as scratch, which are private copies when run in a render process.
+    void RenderPartition(const SortEntry* pEntries, uint32_t numEntries, uint32_t partition, CompositingBuffers& compositingBuffers, const SubmitOptions& options, std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, std::vector<Mesh>& meshBuffer, TextureCache& textureCache)
+    {
+        std::fill(frameBuffer.begin(), frameBuffer.end(), glm::vec3(0, 0, 0));
+        std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+        compositingBuffers.GetStats(partition)->m_Submit = ExecuteDraws(pEntries, numEntries, options, frameBuffer, depthBuffer, vertexBuffer, meshletData, meshBuffer, textureCache);
+
+        memcpy(compositingBuffers.GetColor(partition), frameBuffer.data(), sizeof(glm::vec3) * g_scWidth * g_scHeight);
+        memcpy(compositingBuffers.GetDepth(partition), depthBuffer.data(), sizeof(float) * g_scWidth * g_scHeight);
+    }
+
+#if defined(__linux__)
+    // Single-byte commands exchanged between the submitting process and render processes
+    static const char g_RenderCommand = 'R';
+    static const char g_QuitCommand = 'Q';
+    static const char g_DoneReply = 'D';
+
+    // Returns false if the other end of the socket is gone
+    bool SendCommand(int socket, char command)
+    {
+        ssize_t result = 0;
+        do
+        {
+            // Don't raise SIGPIPE if the render process has died, which is handled by the caller instead
+            result = send(socket, &command, 1, MSG_NOSIGNAL);
+        } while ((result < 0) && (errno == EINTR));
+
+        return (result == 1);
+    }
+
+    // Returns false if the other end of the socket is gone, or nothing arrived within timeoutMs (-1 waits indefinitely)
+    bool ReceiveCommand(int socket, char& command, int timeoutMs)
+    {
+        pollfd pollFd = { socket, POLLIN, 0 };
+        int numReady = 0;
+        do
+        {
+            numReady = poll(&pollFd, 1, timeoutMs);
+        } while ((numReady < 0) && (errno == EINTR));
+
+        if (numReady <= 0)
+            return false;
+
+        ssize_t result = 0;
+        do
+        {
+            result = recv(socket, &command, 1, 0);
+        } while ((result < 0) && (errno == EINTR));
+
+        return (result == 1);
+    }
+
+    // Entry point of a render process, which renders its partition of every frame it's told to until it's told to quit.
+    // Scene data, frame & depth buffers and texture cache are its own copies as of fork(), so its texture cache persists across frames.
+    [[noreturn]] void RenderProcessMain(uint32_t partition, int socket, CompositingBuffers& compositingBuffers, std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, std::vector<Mesh>& meshBuffer, TextureCache& textureCache)
+    {
+        LinearArena frameArena(sizeof(SortEntry) * compositingBuffers.m_MaxDraws + alignof(SortEntry));
+
+        char command = 0;
+        while (ReceiveCommand(socket, command, -1) && (command == g_RenderCommand))
+        {
+            uint64_t numAllocsBefore = g_AllocCounters.m_NumAllocs.load();
+            uint64_t numBytesBefore = g_AllocCounters.m_NumBytes.load();
+
+            frameArena.Reset();
+            textureCache.BeginFrame();
+
+            // Draws are already sorted, so simply point sort entries at this partition's range of them
+            const uint32_t begin = compositingBuffers.GetPartitionBegin()[partition];
+            const uint32_t numEntries = compositingBuffers.GetPartitionBegin()[partition + 1] - begin;
+
+            SortEntry* pEntries = frameArena.Alloc<SortEntry>(numEntries);
+            for (uint32_t i = 0; i < numEntries; i++)
+                pEntries[i] = { 0ull, compositingBuffers.GetDraws() + begin + i, i };
+
+            RenderPartition(pEntries, numEntries, partition, compositingBuffers, *compositingBuffers.GetOptions(), frameBuffer, depthBuffer, vertexBuffer, meshletData, meshBuffer, textureCache);
+
+            PartitionStats& stats = *compositingBuffers.GetStats(partition);
+            stats.m_Submit.m_NumChildAllocs = g_AllocCounters.m_NumAllocs.load() - numAllocsBefore;
+            stats.m_Submit.m_NumChildAllocBytes = g_AllocCounters.m_NumBytes.load() - numBytesBefore;
+            stats.m_TextureCache = textureCache.m_Stats;
+            stats.m_TextureBytesResident = textureCache.m_BytesResident;
+            stats.m_TextureBudget = textureCache.m_Budget;
+
+            if (!SendCommand(socket, g_DoneReply))
+                break;
+        }
+
+        // Leave without running any destructors, e.g. WorkerPool would wait for threads which don't exist in this process
+        _exit(0);
+    }
+#endif
+
+    // Long-lived processes which render one partition of every frame each (Linux only). A render process whose partition couldn't be rendered,
+    // e.g. because it couldn't be spawned or it crashed, is dropped and its partition is rendered in-process from then on.
+    struct RenderProcesses
+    {
+        explicit RenderProcesses(uint32_t numProcesses) :
+            m_Pids(numProcesses, -1),
+            m_Sockets(numProcesses, -1)
+        {
+        }
+
+        ~RenderProcesses()
+        {
+#if defined(__linux__)
+            for (uint32_t p = 0; p < m_Pids.size(); p++)
+            {
+                if (!IsRunning(p))
+                    continue;
+
+                bool quit = Quit(p);
+                close(m_Sockets[p]);
+                if (!quit)
+                    kill(m_Pids[p], SIGKILL);
+
+                int status = 0;
+                waitpid(m_Pids[p], &status, 0);
+                if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+                    ReportFailure(p, status);
+            }
+#endif
+        }
+
+        RenderProcesses(const RenderProcesses&) = delete;
+        RenderProcesses& operator=(const RenderProcesses&) = delete;
+
+        // Must be called before this process starts any threads, as only the calling thread survives in fork()'ed processes.
+        // Each render process renders with its own copy of scene data and texture cache as of now.
+        void Spawn(CompositingBuffers& compositingBuffers, std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, std::vector<Mesh>& meshBuffer, TextureCache& textureCache)
+        {
+#if defined(__linux__)
+            // Flush pending output, otherwise it'd be duplicated by every render process
+            fflush(stdout);
+
+            for (uint32_t p = 0; p < m_Pids.size(); p++)
+            {
+                int sockets[2] = { -1, -1 };
+                if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+                    continue;
+
+                pid_t pid = fork();
+                if (pid == 0)
+                {
+                    // Only keep this render process' own end of its socket
+                    close(sockets[0]);
+                    for (uint32_t q = 0; q < p; q++)
+                    {
+                        if (m_Sockets[q] >= 0)
+                            close(m_Sockets[q]);
+                    }
+
+                    RenderProcessMain(p, sockets[1], compositingBuffers, frameBuffer, depthBuffer, vertexBuffer, meshletData, meshBuffer, textureCache);
+                }
+
+                close(sockets[1]);
+                if (pid < 0)
+                {
+                    close(sockets[0]);
+                    continue;
+                }
+
+                m_Pids[p] = pid;
+                m_Sockets[p] = sockets[0];
+            }
+#endif
+        }
+
+        bool IsRunning(uint32_t p) const
+        {
+            return (m_Pids[p] > 0);
+        }
+
+        // Tell render process to render its partition of the current frame
+        void Kick(uint32_t p)
+        {
+#if defined(__linux__)
+            if (IsRunning(p) && !SendCommand(m_Sockets[p], g_RenderCommand))
+                Drop(p);
+#endif
+        }
+
+        // Wait for render process to finish its partition. Returns false if it didn't, in which case it's dropped.
+        bool Wait(uint32_t p)
+        {
+#if defined(__linux__)
+            if (!IsRunning(p))
+                return false;
+
+            char reply = 0;
+            if (ReceiveCommand(m_Sockets[p], reply, g_RenderProcessTimeoutMs) && (reply == g_DoneReply))
+                return true;
+
+            Drop(p);
+#endif
+            return false;
+        }
+
+#if defined(__linux__)
+        // Tell render process to quit and wait for it to close its end of the socket, which it does as it exits.
+        // Returns false if it didn't within the timeout, i.e. it's hung and needs to be killed.
+        bool Quit(uint32_t p)
+        {
+            if (!SendCommand(m_Sockets[p], g_QuitCommand))
+                return true;
+
+            char reply = 0;
+            pollfd pollFd = { m_Sockets[p], POLLIN, 0 };
+            return (poll(&pollFd, 1, g_RenderProcessTimeoutMs) == 1) && (recv(m_Sockets[p], &reply, 1, 0) == 0);
+        }
+
+        // Shut down a render process which stopped responding. It may still be alive (hung or out of sync) so it's killed before being reaped.
+        void Drop(uint32_t p)
+        {
+            close(m_Sockets[p]);
+            kill(m_Pids[p], SIGKILL);
+
+            int status = 0;
+            waitpid(m_Pids[p], &status, 0);
+            ReportFailure(p, status);
+
+            m_Pids[p] = -1;
+            m_Sockets[p] = -1;
+        }
+
+        void ReportFailure(uint32_t p, int status) const
+        {
+            if (WIFSIGNALED(status))
+                printf("WARNING: Render process %u (pid %d) was killed by signal %d\n", p, static_cast<int>(m_Pids[p]), WTERMSIG(status));
+            else
+                printf("WARNING: Render process %u (pid %d) exited with status %d\n", p, static_cast<int>(m_Pids[p]), WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        }
+
+        std::vector<pid_t>  m_Pids;
+#else
+        std::vector<int>    m_Pids;
+#endif
+        std::vector<int>    m_Sockets;
+    };
+
+    // Sort-last rendering: sorted draws are split into contiguous partitions of roughly equal triangle counts, each of which is rendered by
+    // its own render process into its own color & depth buffers. Partitions are then merged per pixel by depth in a binary tree reduction.
+    // As partitions are contiguous in execution order and later partitions win depth ties, output is identical to Submit(),
+    // given that textures are resident at the same mip levels (each render process streams in its own textures under its own budget).
+    // Final color & depth end up in frame & depth buffers. Partitions without a running render process are rendered in-process one after another.
+    SubmitStats SubmitMultiProcess(const std::vector<CommandBuffer>& cmdBuffers, const SubmitOptions& options, CompositingBuffers& compositingBuffers, RenderProcesses& renderProcesses, WorkerPool& workers, LinearArena& frameArena, std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, std::vector<Mesh>& meshBuffer, TextureCache& textureCache)
+    {
+        const uint32_t numPartitions = compositingBuffers.m_NumPartitions;
+
+        uint32_t numEntries = 0u;
+        SortEntry* pEntries = SortDraws(cmdBuffers, options.m_SortMode, frameArena, meshBuffer, numEntries);
+        assert((numEntries <= compositingBuffers.m_MaxDraws) && "Too many draws for compositing buffers!");
+
+        // Render processes don't see this process' memory, so hand them sorted draws through shared memory
+        *compositingBuffers.GetOptions() = options;
+        for (uint32_t i = 0; i < numEntries; i++)
+            compositingBuffers.GetDraws()[i] = *pEntries[i].m_pCmd;
+
+        // Balance partitions by number of triangles rather than number of draws
+        uint64_t totalIdxCount = 0ull;
+        for (uint32_t i = 0; i < numEntries; i++)
+            totalIdxCount += meshBuffer[pEntries[i].m_pCmd->m_MeshIdx].m_IdxCount;
+
+        uint32_t* pPartitionBegin = compositingBuffers.GetPartitionBegin();
+        {
+            uint64_t idxCount = 0ull;
+            uint32_t entry = 0u;
+            for (uint32_t p = 0; p < numPartitions; p++)
+            {
+                pPartitionBegin[p] = entry;
+
+                const uint64_t partitionEnd = (totalIdxCount * (p + 1)) / numPartitions;
+                while ((entry < numEntries) && (idxCount < partitionEnd))
+                    idxCount += meshBuffer[pEntries[entry++].m_pCmd->m_MeshIdx].m_IdxCount;
+            }
+
+            pPartitionBegin[numPartitions] = numEntries;
+        }
+
+        for (uint32_t p = 0; p < numPartitions; p++)
+            renderProcesses.Kick(p);
+
+        // Render partitions of render processes which aren't running or failed to render this frame in-process instead
+        for (uint32_t p = 0; p < numPartitions; p++)
+        {
+            if (!renderProcesses.Wait(p))
+            {
+                const uint32_t begin = pPartitionBegin[p];
+                RenderPartition(pEntries + begin, pPartitionBegin[p + 1] - begin, p, compositingBuffers, options, frameBuffer, depthBuffer, vertexBuffer, meshletData, meshBuffer, textureCache);
+            }
+        }
+
+        // Composite partitions by depth in a binary tree reduction, splitting the frame into row ranges across workers
+        auto compositeJob = [&](uint32_t workerIdx)
+        {
+            const uint32_t numWorkers = workers.GetNumWorkers();
+            const uint32_t rowBegin = (g_scHeight * workerIdx) / numWorkers;
+            const uint32_t rowEnd = (g_scHeight * (workerIdx + 1)) / numWorkers;
+
+            const uint32_t pixelBegin = rowBegin * g_scWidth;
+            const uint32_t pixelEnd = rowEnd * g_scWidth;
+
+            // At each level, merge partition (i + stride) into partition i, which ends up with the final result in partition 0
+            for (uint32_t stride = 1u; stride < numPartitions; stride *= 2u)
+            {
+                for (uint32_t i = 0u; (i + stride) < numPartitions; i += 2u * stride)
+                {
+                    glm::vec3* pDstColor = compositingBuffers.GetColor(i);
+                    float* pDstDepth = compositingBuffers.GetDepth(i);
+
+                    const glm::vec3* pSrcColor = compositingBuffers.GetColor(i + stride);
+                    const float* pSrcDepth = compositingBuffers.GetDepth(i + stride);
+
+                    for (uint32_t pixel = pixelBegin; pixel < pixelEnd; pixel++)
+                    {
+                        // Source partition comes later in draw order, so it wins ties just like the "less_equal" depth test does
+                        if (pSrcDepth[pixel] <= pDstDepth[pixel])
+                        {
+                            pDstDepth[pixel] = pSrcDepth[pixel];
+                            pDstColor[pixel] = pSrcColor[pixel];
+                        }
+                    }
+                }
+            }
+
+            memcpy(frameBuffer.data() + pixelBegin, compositingBuffers.GetColor(0) + pixelBegin, sizeof(glm::vec3) * (pixelEnd - pixelBegin));
+            memcpy(depthBuffer.data() + pixelBegin, compositingBuffers.GetDepth(0) + pixelBegin, sizeof(float) * (pixelEnd - pixelBegin));
+        };
+
+        workers.Run(compositeJob);
+
+        SubmitStats stats;
+        for (uint32_t p = 0; p < numPartitions; p++)
+        {
+            const SubmitStats& partitionStats = compositingBuffers.GetStats(p)->m_Submit;
+            stats.m_NumDraws += partitionStats.m_NumDraws;
+            stats.m_NumOccluded += partitionStats.m_NumOccluded;
+            stats.m_RasterStats += partitionStats.m_RasterStats;
+            stats.m_DepthOnlyRasterStats += partitionStats.m_DepthOnlyRasterStats;
+            stats.m_NumChildAllocs += partitionStats.m_NumChildAllocs;
+            stats.m_NumChildAllocBytes += partitionStats.m_NumChildAllocBytes;
+        }
+
+        return stats;
+    }
+
+    void OutputFrame(const std::vector<glm::vec3>& frameBuffer, const char* filename)
+    {
+        assert(frameBuffer.size() >= (g_scWidth * g_scHeight));
+
+        FILE* pFile = nullptr;
+        fopen_s(&pFile, filename, "w");
+        fprintf(pFile, "P3\n%d %d\n%d\n ", g_scWidth, g_scHeight, 255);
+        for (auto i = 0; i < g_scWidth * g_scHeight; ++i)
+        {
+            // Write out color values clamped to [0, 255] 
+            uint32_t r = static_cast<uint32_t>(255 * glm::clamp(frameBuffer[i].r, 0.0f, 1.0f));
+            uint32_t g = static_cast<uint32_t>(255 * glm::clamp(frameBuffer[i].g, 0.0f, 1.0f));
+            uint32_t b = static_cast<uint32_t>(255 * glm::clamp(frameBuffer[i].b, 0.0f, 1.0f));
+            fprintf(pFile, "%d %d %d ", r, g, b);
+        }
+        fclose(pFile);
+    }
+
+    // Compute bounding sphere and normal cone of a meshlet whose vertices & triangles are already in place
+    void ComputeMeshletBounds(Meshlet& meshlet, const MeshletData& meshletData, const std::vector<VertexInput>& vertexBuffer)
+    {
+        const uint32_t* pVertices = &meshletData.m_Vertices[meshlet.m_VertexOffset];
+        const uint8_t* pTriangles = &meshletData.m_Triangles[meshlet.m_TriangleOffset];
+
+        // Bounding sphere around the center of bounding box
+        glm::vec3 boundsMin(FLT_MAX);
+        glm::vec3 boundsMax(-FLT_MAX);
+        for (uint32_t v = 0; v < meshlet.m_VertexCount; v++)
+        {
+            boundsMin = glm::min(boundsMin, vertexBuffer[pVertices[v]].Pos);
+            boundsMax = glm::max(boundsMax, vertexBuffer[pVertices[v]].Pos);
+        }
+
+        meshlet.m_Center = (boundsMin + boundsMax) * 0.5f;
+        meshlet.m_Radius = 0.f;
+        for (uint32_t v = 0; v < meshlet.m_VertexCount; v++)
+            meshlet.m_Radius = std::max(meshlet.m_Radius, glm::length(vertexBuffer[pVertices[v]].Pos - meshlet.m_Center));
+
+        // Normal cone axis is the average of (front-facing, i.e. counter-clockwise) triangle normals.
+        // Degenerate triangles are never rasterized, so they don't constrain the cone either.
+        glm::vec3 normals[g_MeshletMaxTriangles];
+        bool valid[g_MeshletMaxTriangles];
+
+        glm::vec3 axis(0.f);
+        for (uint32_t t = 0; t < meshlet.m_TriangleCount; t++)
+        {
+            const glm::vec3& p0 = vertexBuffer[pVertices[pTriangles[t * 3]]].Pos;
+            const glm::vec3& p1 = vertexBuffer[pVertices[pTriangles[t * 3 + 1]]].Pos;
+            const glm::vec3& p2 = vertexBuffer[pVertices[pTriangles[t * 3 + 2]]].Pos;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+
+            valid[t] = (length > 0.f);
+            normals[t] = valid[t] ? (normal / length) : glm::vec3(0.f);
+            axis += normals[t];
+        }
+
+        meshlet.m_ConeApex = meshlet.m_Center;
+        meshlet.m_ConeAxis = glm::vec3(0.f);
+        meshlet.m_ConeCutoff = 1.f;
+
+        float axisLength = glm::length(axis);
+        if (axisLength <= 0.f)
+            return;
+
+        axis /= axisLength;
+
+        float minDot = 1.f;
+        for (uint32_t t = 0; t < meshlet.m_TriangleCount; t++)
+        {
+            if (valid[t])
+                minDot = std::min(minDot, glm::dot(normals[t], axis));
+        }
+
+        // Cone is too wide (spanning ~85 degrees or more around its axis) to cull much and would be numerically unstable anyway
+        if (minDot <= 0.1f)
+            return;
+
+        // Move the apex back along the axis until it lies behind the planes of all triangles, so that the cone test
+        // is valid for any view point regardless of where exactly each triangle is located within the meshlet
+        float maxT = 0.f;
+        for (uint32_t t = 0; t < meshlet.m_TriangleCount; t++)
+        {
+            if (!valid[t])
+                continue;
+
+            const glm::vec3& p0 = vertexBuffer[pVertices[pTriangles[t * 3]]].Pos;
+
+            // dot(center - t * axis - p0, normal) = 0
+            float tri = glm::dot(meshlet.m_Center - p0, normals[t]) / glm::dot(axis, normals[t]);
+            maxT = std::max(maxT, tri);
+        }
+
+        meshlet.m_ConeApex = meshlet.m_Center - axis * maxT;
+        meshlet.m_ConeAxis = axis;
+
+        // All normals are within acos(minDot) of the axis, so the view direction has to be within 90 - acos(minDot) degrees
+        // of the axis for all of them to face away, which is where sin(acos(minDot)) comes from
+        meshlet.m_ConeCutoff = glm::sqrt(1.f - minDot * minDot);
+    }
+
+    // Greedily split each mesh into meshlets by walking its triangles in order, so that drawing meshlets keeps the original draw order
+    void BuildMeshlets(std::vector<Mesh>& meshBuffer, const std::vector<VertexInput>& vertexBuffer, const std::vector<uint32_t>& indexBuffer, MeshletData& meshletData)
+    {
+        // Local index of each vertex in the meshlet being built, -1 if it's not referenced yet
+        std::vector<int32_t> localIndices(vertexBuffer.size(), -1);
+
+        for (Mesh& mesh : meshBuffer)
+        {
+            mesh.m_MeshletOffset = static_cast<uint32_t>(meshletData.m_Meshlets.size());
+
+            Meshlet meshlet;
+            meshlet.m_VertexOffset = static_cast<uint32_t>(meshletData.m_Vertices.size());
+            meshlet.m_TriangleOffset = static_cast<uint32_t>(meshletData.m_Triangles.size());
+
+            auto flush = [&]()
+            {
+                if (meshlet.m_TriangleCount == 0u)
+                    return;
+
+                ComputeMeshletBounds(meshlet, meshletData, vertexBuffer);
+                meshletData.m_Meshlets.push_back(meshlet);
+
+                for (uint32_t v = 0; v < meshlet.m_VertexCount; v++)
+                    localIndices[meshletData.m_Vertices[meshlet.m_VertexOffset + v]] = -1;
+
+                meshlet = Meshlet();
+                meshlet.m_VertexOffset = static_cast<uint32_t>(meshletData.m_Vertices.size());
+                meshlet.m_TriangleOffset = static_cast<uint32_t>(meshletData.m_Triangles.size());
+            };
+
+            const uint32_t triCount = mesh.m_IdxCount / 3;
+            for (uint32_t idx = 0; idx < triCount; idx++)
+            {
+                const uint32_t* pIndices = &indexBuffer[mesh.m_IdxOffset + idx * 3];
+
+                uint32_t numNewVertices = 0u;
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    // Don't count the same new vertex twice in case of degenerate triangles
+                    bool seen = (localIndices[pIndices[i]] != -1) || ((i > 0) && (pIndices[i] == pIndices[0])) || ((i > 1) && (pIndices[i] == pIndices[1]));
+                    numNewVertices += seen ? 0u : 1u;
+                }
+
+                if (((meshlet.m_VertexCount + numNewVertices) > g_MeshletMaxVertices) || ((meshlet.m_TriangleCount + 1) > g_MeshletMaxTriangles))
+                    flush();
+
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    int32_t& localIdx = localIndices[pIndices[i]];
+                    if (localIdx == -1)
+                    {
+                        localIdx = static_cast<int32_t>(meshlet.m_VertexCount++);
+                        meshletData.m_Vertices.push_back(pIndices[i]);
+                    }
+
+                    meshletData.m_Triangles.push_back(static_cast<uint8_t>(localIdx));
+                }
+
+                meshlet.m_TriangleCount++;
+            }
+
+            flush();
+
+            mesh.m_MeshletCount = static_cast<uint32_t>(meshletData.m_Meshlets.size()) - mesh.m_MeshletOffset;
+        }
+    }
+
+    // Header of meshlet files, which are stored next to .OBJ files
+    struct MeshletFileHeader
     {
-        glm::vec3   Pos;
-        glm::vec3   Normal;
-        glm::vec2   TexCoords;
+        uint32_t    m_Magic = 0u;
+        uint32_t    m_Version = 0u;
+
+        // Used to detect meshlet files which are out of date with respect to their .OBJ
+        uint64_t    m_IndexHash = 0ull;
+        uint64_t    m_PositionHash = 0ull;
+        uint32_t    m_NumVertices = 0u;
+        uint32_t    m_NumIndices = 0u;
+        uint32_t    m_NumMeshes = 0u;
+
+        // Limits meshlets were built with, which DrawIndexed() & DrawIndexedDepthOnly() size their per-meshlet arrays by
+        uint32_t    m_MaxVertices = 0u;
+        uint32_t    m_MaxTriangles = 0u;
+
+        // Meshlets are written out as is, so their layout has to match as well
+        uint32_t    m_MeshletSize = 0u;
+
+        uint32_t    m_NumMeshlets = 0u;
+        uint32_t    m_NumMeshletVertices = 0u;
+        uint32_t    m_NumMeshletTriangleIndices = 0u;
     };
 
-    // Vertex Shader payload, which will be passed to each FS invocation as input
-    struct FragmentInput
+    static const uint32_t g_MeshletFileMagic = 0x4C48534Du; // "MSHL"
+    static const uint32_t g_MeshletFileVersion = 3u;
+
+    static const uint64_t g_FNVOffsetBasis = 14695981039346656037ull;
+
+    // FNV-1a hash of given bytes, continuing from a previous hash if given
+    uint64_t HashBytes(const void* pData, size_t size, uint64_t hash = g_FNVOffsetBasis)
     {
-        glm::vec3   Normal;
-        glm::vec2   TexCoords;
-    };
+        const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
 
-    // Indexed mesh
-    struct Mesh
+        return hash;
+    }
+
+    MeshletFileHeader MakeMeshletFileHeader(const std::vector<Mesh>& meshBuffer, const std::vector<VertexInput>& vertexBuffer, const std::vector<uint32_t>& indexBuffer)
     {
-        // Offset into the global index buffer
-        uint32_t    m_IdxOffset = 0u;
+        // Header is written out as is, so don't leave any padding bytes uninitialized
+        MeshletFileHeader header;
+        memset(static_cast<void*>(&header), 0, sizeof(header));
+
+        header.m_Magic = g_MeshletFileMagic;
+        header.m_Version = g_MeshletFileVersion;
+        header.m_IndexHash = HashBytes(indexBuffer.data(), sizeof(uint32_t) * indexBuffer.size());
+
+        // Meshlet bounds & normal cones depend on vertex positions
+        header.m_PositionHash = g_FNVOffsetBasis;
+        for (const VertexInput& vertex : vertexBuffer)
+            header.m_PositionHash = HashBytes(&vertex.Pos, sizeof(vertex.Pos), header.m_PositionHash);
+
+        header.m_NumVertices = static_cast<uint32_t>(vertexBuffer.size());
+        header.m_NumIndices = static_cast<uint32_t>(indexBuffer.size());
+        header.m_NumMeshes = static_cast<uint32_t>(meshBuffer.size());
+        header.m_MaxVertices = g_MeshletMaxVertices;
+        header.m_MaxTriangles = g_MeshletMaxTriangles;
+        header.m_MeshletSize = static_cast<uint32_t>(sizeof(Meshlet));
+
+        return header;
+    }
 
-        // How many indices this mesh contains. Number of triangles therefore equals (m_IdxCount / 3)
-        uint32_t    m_IdxCount = 0u;
+    // Check that meshes & meshlets only reference data which exists and that meshlets are within limits, so that loaded meshlets are safe to draw
+    bool ValidateMeshlets(const std::vector<Mesh>& meshBuffer, const std::vector<VertexInput>& vertexBuffer, const MeshletData& meshletData)
+    {
+        for (const Mesh& mesh : meshBuffer)
+        {
+            if ((static_cast<uint64_t>(mesh.m_MeshletOffset) + mesh.m_MeshletCount) > meshletData.m_Meshlets.size())
+                return false;
+        }
 
-        // Texture map from material
-        std::string m_DiffuseTexName;
-    };
+        for (const Meshlet& meshlet : meshletData.m_Meshlets)
+        {
+            if ((meshlet.m_VertexCount > g_MeshletMaxVertices) || (meshlet.m_TriangleCount > g_MeshletMaxTriangles))
+                return false;
 
-    void DrawIndexed(std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, std::vector<uint32_t>& indexBuffer, Mesh& mesh, glm::mat4& MVP, Texture* pTexture);
+            if (((static_cast<uint64_t>(meshlet.m_VertexOffset) + meshlet.m_VertexCount) > meshletData.m_Vertices.size()) ||
+                ((static_cast<uint64_t>(meshlet.m_TriangleOffset) + 3ull * meshlet.m_TriangleCount) > meshletData.m_Triangles.size()))
+                return false;
 
-    void OutputFrame(const std::vector<glm::vec3>& frameBuffer, const char* filename)
+            for (uint32_t v = 0; v < meshlet.m_VertexCount; v++)
+            {
+                if (meshletData.m_Vertices[meshlet.m_VertexOffset + v] >= vertexBuffer.size())
+                    return false;
+            }
+
+            for (uint32_t i = 0; i < (3u * meshlet.m_TriangleCount); i++)
+            {
+                if (meshletData.m_Triangles[meshlet.m_TriangleOffset + i] >= meshlet.m_VertexCount)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Number of bytes left to read from given file, or -1 if it can't be told
+    int64_t GetRemainingFileSize(FILE* pFile)
     {
-        assert(frameBuffer.size() >= (g_scWidth * g_scHeight));
+        const long position = ftell(pFile);
+        if ((position < 0) || (fseek(pFile, 0, SEEK_END) != 0))
+            return -1;
+
+        const long end = ftell(pFile);
+        if ((end < position) || (fseek(pFile, position, SEEK_SET) != 0))
+            return -1;
 
+        return static_cast<int64_t>(end - position);
+    }
+
+    bool LoadMeshlets(const std::string& fileName, std::vector<Mesh>& meshBuffer, const std::vector<VertexInput>& vertexBuffer, const std::vector<uint32_t>& indexBuffer, MeshletData& meshletData)
+    {
         FILE* pFile = nullptr;
-        fopen_s(&pFile, filename, "w");
-        fprintf(pFile, "P3\n%d %d\n%d\n ", g_scWidth, g_scHeight, 255);
-        for (auto i = 0; i < g_scWidth * g_scHeight; ++i)
+        fopen_s(&pFile, fileName.c_str(), "rb");
+        if (pFile == nullptr)
+            return false;
+
+        MeshletFileHeader expected = MakeMeshletFileHeader(meshBuffer, vertexBuffer, indexBuffer);
+
+        MeshletFileHeader header;
+        bool valid = (fread(&header, sizeof(header), 1, pFile) == 1) &&
+            (header.m_Magic == expected.m_Magic) && (header.m_Version == expected.m_Version) &&
+            (header.m_IndexHash == expected.m_IndexHash) && (header.m_PositionHash == expected.m_PositionHash) &&
+            (header.m_NumVertices == expected.m_NumVertices) && (header.m_NumIndices == expected.m_NumIndices) &&
+            (header.m_NumMeshes == expected.m_NumMeshes) &&
+            (header.m_MaxVertices == expected.m_MaxVertices) && (header.m_MaxTriangles == expected.m_MaxTriangles) &&
+            (header.m_MeshletSize == expected.m_MeshletSize);
+
+        // Bound counts before allocating by them: every meshlet holds at least one triangle, and every index ends up as one local triangle index
+        // referencing at most one meshlet vertex. Rest of the file has to hold exactly what the counts call for, too.
+        valid = valid &&
+            (header.m_NumMeshlets <= (header.m_NumIndices / 3u)) &&
+            (header.m_NumMeshletVertices <= header.m_NumIndices) &&
+            (header.m_NumMeshletTriangleIndices <= header.m_NumIndices) &&
+            (GetRemainingFileSize(pFile) == static_cast<int64_t>(
+                (2ull * sizeof(uint32_t) * header.m_NumMeshes) +
+                (sizeof(Meshlet) * static_cast<uint64_t>(header.m_NumMeshlets)) +
+                (sizeof(uint32_t) * static_cast<uint64_t>(header.m_NumMeshletVertices)) +
+                (sizeof(uint8_t) * static_cast<uint64_t>(header.m_NumMeshletTriangleIndices))));
+
+        if (valid)
         {
-            // Write out color values clamped to [0, 255] 
-            uint32_t r = static_cast<uint32_t>(255 * glm::clamp(frameBuffer[i].r, 0.0f, 1.0f));
-            uint32_t g = static_cast<uint32_t>(255 * glm::clamp(frameBuffer[i].g, 0.0f, 1.0f));
-            uint32_t b = static_cast<uint32_t>(255 * glm::clamp(frameBuffer[i].b, 0.0f, 1.0f));
-            fprintf(pFile, "%d %d %d ", r, g, b);
+            meshletData.m_Meshlets.resize(header.m_NumMeshlets);
+            meshletData.m_Vertices.resize(header.m_NumMeshletVertices);
+            meshletData.m_Triangles.resize(header.m_NumMeshletTriangleIndices);
+
+            for (Mesh& mesh : meshBuffer)
+            {
+                valid = valid &&
+                    (fread(&mesh.m_MeshletOffset, sizeof(uint32_t), 1, pFile) == 1) &&
+                    (fread(&mesh.m_MeshletCount, sizeof(uint32_t), 1, pFile) == 1);
+            }
+
+            valid = valid &&
+                (fread(meshletData.m_Meshlets.data(), sizeof(Meshlet), header.m_NumMeshlets, pFile) == header.m_NumMeshlets) &&
+                (fread(meshletData.m_Vertices.data(), sizeof(uint32_t), header.m_NumMeshletVertices, pFile) == header.m_NumMeshletVertices) &&
+                (fread(meshletData.m_Triangles.data(), sizeof(uint8_t), header.m_NumMeshletTriangleIndices, pFile) == header.m_NumMeshletTriangleIndices);
+
+            // A corrupt file could otherwise index out of bounds at draw time
+            valid = valid && ValidateMeshlets(meshBuffer, vertexBuffer, meshletData);
+        }
+
+        fclose(pFile);
+
+        if (!valid)
+        {
+            meshletData = MeshletData();
+            for (Mesh& mesh : meshBuffer)
+                mesh.m_MeshletOffset = mesh.m_MeshletCount = 0u;
+        }
+
+        return valid;
+    }
+
+    void SaveMeshlets(const std::string& fileName, const std::vector<Mesh>& meshBuffer, const std::vector<VertexInput>& vertexBuffer, const std::vector<uint32_t>& indexBuffer, const MeshletData& meshletData)
+    {
+        FILE* pFile = nullptr;
+        fopen_s(&pFile, fileName.c_str(), "wb");
+        if (pFile == nullptr)
+        {
+            printf("WARNING: Failed to write meshlets to %s\n", fileName.c_str());
+            return;
+        }
+
+        MeshletFileHeader header = MakeMeshletFileHeader(meshBuffer, vertexBuffer, indexBuffer);
+        header.m_NumMeshlets = static_cast<uint32_t>(meshletData.m_Meshlets.size());
+        header.m_NumMeshletVertices = static_cast<uint32_t>(meshletData.m_Vertices.size());
+        header.m_NumMeshletTriangleIndices = static_cast<uint32_t>(meshletData.m_Triangles.size());
+
+        fwrite(&header, sizeof(header), 1, pFile);
+
+        for (const Mesh& mesh : meshBuffer)
+        {
+            fwrite(&mesh.m_MeshletOffset, sizeof(uint32_t), 1, pFile);
+            fwrite(&mesh.m_MeshletCount, sizeof(uint32_t), 1, pFile);
         }
+
+        fwrite(meshletData.m_Meshlets.data(), sizeof(Meshlet), meshletData.m_Meshlets.size(), pFile);
+        fwrite(meshletData.m_Vertices.data(), sizeof(uint32_t), meshletData.m_Vertices.size(), pFile);
+        fwrite(meshletData.m_Triangles.data(), sizeof(uint8_t), meshletData.m_Triangles.size(), pFile);
+
         fclose(pFile);
     }
 
-    void InitializeSceneObjects(const char* fileName, std::vector<Mesh>& meshBuffer, std::vector<VertexInput>& vertexBuffer, std::vector<uint32_t>& indexBuffer, std::map<std::string, Texture*>& textures)
+    void InitializeSceneObjects(const char* fileName, std::vector<Mesh>& meshBuffer, std::vector<VertexInput>& vertexBuffer, std::vector<uint32_t>& indexBuffer, TextureCache& textureCache, MeshletData& meshletData)
     {
         tinyobj::attrib_t attribs;
         std::vector<tinyobj::shape_t> shapes;
@@ -78,8 +1754,14 @@ namespace partIII
         bool ret = tinyobj::LoadObj(&attribs, &shapes, &materials, nullptr, &err, fileName, "../assets/", true /*triangulate*/, true /*default_vcols_fallback*/);
         if (ret)
         {
-            // Process materials to load images
+            // Material handle of each .OBJ material, which references its texture map in the texture cache
+            std::vector<MaterialHandle> materialHandles(materials.size(), g_InvalidMaterial);
+
+            // Process materials to register images, which are only streamed in once they're needed for shading
             {
+                // Texture names are only looked up here, so that materials sharing the same texture map share a handle as well
+                std::map<std::string, MaterialHandle> handlesByName;
+
                 for (unsigned i = 0; i < materials.size(); i++)
                 {
                     const tinyobj::material_t& m = materials[i];
@@ -87,14 +1769,17 @@ namespace partIII
                     std::string diffuseTexName = m.diffuse_texname;
                     assert(!diffuseTexName.empty() && "Mesh missing texture!");
 
-                    if (textures.find(diffuseTexName) == textures.end())
+                    auto res = handlesByName.find(diffuseTexName);
+                    if (res == handlesByName.end())
                     {
-                        Texture* pAlbedo = new Texture();
-
-                        pAlbedo->m_Data = stbi_load(("../assets/" + diffuseTexName).c_str(), &pAlbedo->m_Width, &pAlbedo->m_Height, &pAlbedo->m_NumChannels, 0);
-                        assert(pAlbedo->m_Data != nullptr && "Failed to load image!");
+                        MaterialHandle handle = textureCache.Register("../assets/" + diffuseTexName);
 
-                        textures[diffuseTexName] = pAlbedo;
+                        handlesByName[diffuseTexName] = handle;
+                        materialHandles[i] = handle;
+                    }
+                    else
+                    {
+                        materialHandles[i] = res->second;
                     }
                 }
             }
@@ -120,6 +1805,9 @@ namespace partIII
                     const tinyobj::shape_t& shape = shapes[s];
 
                     uint32_t meshIdxBase = indexBuffer.size();
+
+                    // Push new mesh to be rendered in the scene
+                    Mesh mesh;
                     for (size_t i = 0; i < shape.mesh.indices.size(); i++)
                     {
                         auto index = shape.mesh.indices[i];
@@ -144,6 +1832,10 @@ namespace partIII
                         {
                             // Vertex is already defined in terms of POS/NORMAL/UV indices, just append index data to index buffer
                             indexBuffer.push_back(res->second);
+
+                            // Vertex may have been first referenced by another mesh, so account for it in bounds of this one too
+                            mesh.m_BoundsMin = glm::min(mesh.m_BoundsMin, vertexBuffer[res->second].Pos);
+                            mesh.m_BoundsMax = glm::max(mesh.m_BoundsMax, vertexBuffer[res->second].Pos);
                         }
                         else
                         {
@@ -158,6 +1850,9 @@ namespace partIII
 
                             glm::vec3 pos(vx, vy, vz);
 
+                            mesh.m_BoundsMin = glm::min(mesh.m_BoundsMin, pos);
+                            mesh.m_BoundsMax = glm::max(mesh.m_BoundsMax, pos);
+
                             glm::vec3 normal(0.f);
                             if (hasNormals)
                             {
@@ -185,17 +1880,25 @@ namespace partIII
                         }
                     }
 
-                    // Push new mesh to be rendered in the scene 
-                    Mesh mesh;
                     mesh.m_IdxOffset = meshIdxBase;
                     mesh.m_IdxCount = shape.mesh.indices.size();
 
                     assert((shape.mesh.material_ids[0] != -1) && "Mesh missing a material!");
-                    mesh.m_DiffuseTexName = materials[shape.mesh.material_ids[0]].diffuse_texname; // No per-face material but fixed one
+                    mesh.m_Material = materialHandles[shape.mesh.material_ids[0]]; // No per-face material but fixed one
 
                     meshBuffer.push_back(mesh);
                 }
             }
+
+            // Split meshes into meshlets, or load them from the previous run if the .OBJ hasn't changed since
+            {
+                std::string meshletFileName = std::string(fileName) + ".meshlets";
+                if (!LoadMeshlets(meshletFileName, meshBuffer, vertexBuffer, indexBuffer, meshletData))
+                {
+                    BuildMeshlets(meshBuffer, vertexBuffer, indexBuffer, meshletData);
+                    SaveMeshlets(meshletFileName, meshBuffer, vertexBuffer, indexBuffer, meshletData);
+                }
+            }
         }
         else
         {
@@ -204,7 +1907,8 @@ namespace partIII
         }
     }
 
-    void GoWild()
+    // Returns false if a steady-state frame allocated from heap, or if verification of compositing was requested and failed
+    bool GoWild(const RenderSettings& settings)
     {
         // Allocate and clear the frame buffer before starting to render to it
         std::vector<glm::vec3> frameBuffer(g_scWidth * g_scHeight, glm::vec3(0, 0, 0)); // clear color black = vec3(0, 0, 0)
@@ -216,11 +1920,17 @@ namespace partIII
         std::vector<VertexInput> vertexBuffer;
         std::vector<uint32_t> indexBuffer;
 
+        // Meshes are split into meshlets, which are culled as a whole at draw time
+        MeshletData meshletData;
+
         // Store data of all scene objects to be drawn
         std::vector<Mesh> primitives;
 
-        // All texture maps loaded. Every mesh will reference their texture map by name at draw time
-        std::map<std::string, Texture*> textures;
+        // All texture maps referenced by the scene, streamed in on demand under a fixed memory budget.
+        // Every mesh will reference their texture map by material handle at draw time.
+        // When rendering with multiple processes, each of them gets its own copy of the cache with the whole budget. As a partition's textures
+        // are a subset of the frame's, they're then kept at full resolution whenever those of the frame would be in a single process.
+        TextureCache textureCache(g_TextureMemoryBudget);
 
 #if 1
         const auto fileName = "../assets/sponza.obj";
@@ -229,7 +1939,7 @@ namespace partIII
 #endif
 
         // Load .OBJ file and process it to construct a scene of multiple meshes
-        InitializeSceneObjects(fileName, primitives, vertexBuffer, indexBuffer, textures);
+        InitializeSceneObjects(fileName, primitives, vertexBuffer, indexBuffer, textureCache, meshletData);
 
 #if 1
         // Build view & projection matrices (right-handed sysem)
@@ -253,18 +1963,145 @@ namespace partIII
 
         glm::mat4 MVP = proj * view;
 
-        // Loop over all objects in the scene and draw them one by one
-        for (auto i = 0; i < primitives.size(); i++)
+        // Buffers shared with render processes, sized for one draw per mesh and frame
+        const bool multiProcess = (settings.m_NumRenderProcesses > 1);
+        CompositingBuffers compositingBuffers(multiProcess ? settings.m_NumRenderProcesses : 0u, multiProcess ? static_cast<uint32_t>(primitives.size()) : 0u);
+
+        // Render processes are spawned once and live until the end, so that each keeps its textures resident across frames.
+        // Spawned before any threads are started, as fork() only clones the calling thread.
+        RenderProcesses renderProcesses(multiProcess ? settings.m_NumRenderProcesses : 0u);
+        if (multiProcess)
+            renderProcesses.Spawn(compositingBuffers, frameBuffer, depthBuffer, vertexBuffer, meshletData, primitives, textureCache);
+
+        // Draws are recorded on multiple worker threads, each of which fills its own command buffer out of its own frame arena
+        WorkerPool workers(std::max(1u, std::thread::hardware_concurrency()));
+        const uint32_t numWorkers = workers.GetNumWorkers();
+
+        std::vector<LinearArena> workerArenas;
+        workerArenas.reserve(numWorkers);
+        for (uint32_t i = 0; i < numWorkers; i++)
+            workerArenas.emplace_back(g_FrameArenaSize);
+
+        std::vector<CommandBuffer> cmdBuffers(numWorkers);
+
+        // Scratch memory of the submitting thread
+        LinearArena frameArena(g_FrameArenaSize);
+
+        // Draws are grouped by material to keep the same texture hot in cache.
+        // Depth of the whole scene is laid down first, so that occluded meshes are culled and only visible fragments are shaded.
+        SubmitOptions submitOptions;
+        submitOptions.m_SortMode = SortMode::Material;
+        submitOptions.m_DepthPrepass = true;
+        submitOptions.m_OcclusionCulling = true;
+
+        auto recordJob = [&](uint32_t workerIdx)
+        {
+            LinearArena& arena = workerArenas[workerIdx];
+            arena.Reset();
+
+            // Each worker records a contiguous range of objects so that concatenated buffers keep scene order
+            size_t begin = (primitives.size() * workerIdx) / numWorkers;
+            size_t end = (primitives.size() * (workerIdx + 1)) / numWorkers;
+
+            CommandBuffer& cmdBuffer = cmdBuffers[workerIdx];
+            cmdBuffer.Begin(arena, static_cast<uint32_t>(end - begin));
+
+            for (size_t i = begin; i < end; i++)
+                cmdBuffer.RecordDraw(static_cast<uint32_t>(i), MVP, primitives[i].m_Material);
+        };
+
+        bool success = true;
+
+        // Render the same frame multiple times; once everything is set up, frames shouldn't touch the heap at all
+        for (uint32_t frame = 0; frame < g_NumFrames; frame++)
         {
-            DrawIndexed(frameBuffer, depthBuffer, vertexBuffer, indexBuffer, primitives[i], MVP, textures[primitives[i].m_DiffuseTexName]);
+            uint64_t numAllocsBefore = g_AllocCounters.m_NumAllocs.load();
+            uint64_t numBytesBefore = g_AllocCounters.m_NumBytes.load();
+
+            // Clear frame & depth buffers and release last frame's scratch memory
+            std::fill(frameBuffer.begin(), frameBuffer.end(), glm::vec3(0, 0, 0));
+            std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+            frameArena.Reset();
+            textureCache.BeginFrame();
+
+            workers.Run(recordJob);
+
+            // Submit all recorded draws at once
+            SubmitStats submitStats;
+            if (multiProcess)
+                submitStats = SubmitMultiProcess(cmdBuffers, submitOptions, compositingBuffers, renderProcesses, workers, frameArena, frameBuffer, depthBuffer, vertexBuffer, meshletData, primitives, textureCache);
+            else
+                submitStats = Submit(cmdBuffers, submitOptions, frameArena, frameBuffer, depthBuffer, vertexBuffer, meshletData, primitives, textureCache);
+            printf("Frame %u: %u draws submitted, %u culled by occlusion queries\n", frame, submitStats.m_NumDraws, submitStats.m_NumOccluded);
+
+            PrintRasterStats(frame, "shading pass", submitStats.m_RasterStats);
+            PrintRasterStats(frame, "depth-only passes", submitStats.m_DepthOnlyRasterStats);
+
+            // Count heap allocations of render processes too, which report them back along with their stats
+            uint64_t numAllocs = g_AllocCounters.m_NumAllocs.load() - numAllocsBefore + submitStats.m_NumChildAllocs;
+            uint64_t numBytes = g_AllocCounters.m_NumBytes.load() - numBytesBefore + submitStats.m_NumChildAllocBytes;
+            printf("Frame %u: %llu heap allocations (%llu bytes), frame arena peak: %zu bytes\n", frame, static_cast<unsigned long long>(numAllocs), static_cast<unsigned long long>(numBytes), frameArena.m_HighWater);
+
+            // Checked in release builds as well, as this is what steady-state frames are meant to guarantee
+            if ((frame > 0) && (numAllocs > 0))
+            {
+                printf("ERROR: Steady-state frame %u allocated from heap!\n", frame);
+                success = false;
+            }
+        }
+
+        if (settings.m_VerifyCompositing && multiProcess)
+        {
+            // Command buffers still hold draws of the last frame, so simply submit them again in-process.
+            // Single-process rendering gets the same texture budget as each render process, just like it would without --processes.
+            std::vector<glm::vec3> refFrameBuffer(g_scWidth * g_scHeight, glm::vec3(0, 0, 0));
+            std::vector<float> refDepthBuffer(g_scWidth * g_scHeight, FLT_MAX);
+
+            TextureCache refTextureCache(g_TextureMemoryBudget);
+            for (const TextureCache::Entry& entry : textureCache.m_Entries)
+                refTextureCache.Register(entry.m_FileName);
+            refTextureCache.BeginFrame();
+
+            Submit(cmdBuffers, submitOptions, frameArena, refFrameBuffer, refDepthBuffer, vertexBuffer, meshletData, primitives, refTextureCache);
+
+            // Output is only guaranteed to match if textures are drawn at the same mip levels everywhere, i.e. none had to be downsampled
+            bool downsampled = (refTextureCache.m_Stats.m_NumDownsampled > 0) || (textureCache.m_Stats.m_NumDownsampled > 0);
+            for (uint32_t p = 0; p < settings.m_NumRenderProcesses; p++)
+                downsampled = downsampled || (compositingBuffers.GetStats(p)->m_TextureCache.m_NumDownsampled > 0);
+
+            if (downsampled)
+                printf("WARNING: Textures didn't fit in budget at full resolution, so processes may have drawn them at different mip levels\n");
+
+            bool identical =
+                (memcmp(refFrameBuffer.data(), frameBuffer.data(), sizeof(glm::vec3) * g_scWidth * g_scHeight) == 0) &&
+                (memcmp(refDepthBuffer.data(), depthBuffer.data(), sizeof(float) * g_scWidth * g_scHeight) == 0);
+
+            printf("Compositing %u processes %s single-process rendering\n", settings.m_NumRenderProcesses, identical ? "matches" : "DOES NOT match");
+            success = success && identical;
         }
 
         // Rendering of one frame is finished, output a .PPM file of the contents of our frame buffer to see what we actually just rendered
         OutputFrame(frameBuffer, "../render_go_wild.ppm");
 
-        // Clean up resources
-        for (const auto& elem : textures)
-            delete elem.second;
+        // Render processes stream textures into caches of their own, whose stats are reported back through shared memory.
+        // Cache of this process is only used for partitions whose render process failed.
+        textureCache.PrintStats(multiProcess ? "submitting process" : nullptr);
+        for (uint32_t p = 0; multiProcess && (p < settings.m_NumRenderProcesses); p++)
+        {
+            const PartitionStats& stats = *compositingBuffers.GetStats(p);
+
+            char name[32];
+            snprintf(name, sizeof(name), "render process %u", p);
+            PrintTextureCacheStats(name, stats.m_TextureCache, stats.m_TextureBytesResident, stats.m_TextureBudget);
+        }
+
+        return success;
+    }
+
+    // Position-only Vertex Shader for depth-only passes, which has to output exactly the same clip-space position as VS
+    glm::vec4 VSDepthOnly(const VertexInput& input, const glm::mat4& MVP)
+    {
+        return (MVP * glm::vec4(input.Pos, 1.0f));
     }
 
     // Vertex Shader to apply perspective projections and also pass vertex attributes to Fragment Shader
@@ -283,9 +2120,10 @@ namespace partIII
     {
 #if 1 // Render textured polygons
 
-        // By using fractional part of texture coordinates only, we will REPEAT (or WRAP) the same texture multiple times
-        uint32_t idxS = static_cast<uint32_t>((input.TexCoords.s - static_cast<int64_t>(input.TexCoords.s)) * pTexture->m_Width - 0.5f);
-        uint32_t idxT = static_cast<uint32_t>((input.TexCoords.t - static_cast<int64_t>(input.TexCoords.t)) * pTexture->m_Height - 0.5f);
+        // By using fractional part of texture coordinates only, we will REPEAT (or WRAP) the same texture multiple times.
+        // Interpolated coordinates may land slightly outside of the triangle's range, so texel indices are clamped as well.
+        uint32_t idxS = static_cast<uint32_t>(glm::clamp(static_cast<int32_t>((input.TexCoords.s - glm::floor(input.TexCoords.s)) * pTexture->m_Width - 0.5f), 0, pTexture->m_Width - 1));
+        uint32_t idxT = static_cast<uint32_t>(glm::clamp(static_cast<int32_t>((input.TexCoords.t - glm::floor(input.TexCoords.t)) * pTexture->m_Height - 0.5f), 0, pTexture->m_Height - 1));
         uint32_t idx = (idxT * pTexture->m_Width + idxS) * pTexture->m_NumChannels;
 
         float r = static_cast<float>(pTexture->m_Data[idx++] * (1.f / 255));
@@ -314,133 +2152,452 @@ namespace partIII
         else return true;
     }
 
-    void DrawIndexed(std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, std::vector<uint32_t>& indexBuffer, Mesh& mesh, glm::mat4& MVP, Texture* pTexture)
+    // 2D edge function of edge (a, b) at given sample in raster space. It's evaluated in a canonical vertex order so that the result for (b, a)
+    // is the exact negation of the one for (a, b), hence samples on edges shared by two triangles are never missed nor shaded twice.
+    float EdgeFunction2D(const glm::vec2& a, const glm::vec2& b, const glm::vec2& sample)
     {
-        assert(pTexture != nullptr);
+        if ((a.x < b.x) || ((a.x == b.x) && (a.y < b.y)))
+            return ((b.x - a.x) * (sample.y - a.y)) - ((b.y - a.y) * (sample.x - a.x));
+        else
+            return -(((a.x - b.x) * (sample.y - b.y)) - ((a.y - b.y) * (sample.x - b.x)));
+    }
 
-        const int32_t triCount = mesh.m_IdxCount / 3;
+    // Evaluate edge (a, b) of a front-facing projected triangle at given sample, applying the same tie-breaking rules as EvaluateEdgeFunction()
+    bool EvaluateEdgeFunction2D(const glm::vec2& a, const glm::vec2& b, const glm::vec2& sample)
+    {
+        // Front-facing triangles have negative area in raster space, so flip the sign to have positive values inside
+        float result = -EdgeFunction2D(a, b, sample);
 
-        // Loop over triangles in a given mesh and rasterize them
-        for (int32_t idx = 0; idx < triCount; idx++)
-        {
-            // Fetch vertex input of next triangle to be rasterized
-            const VertexInput& vi0 = vertexBuffer[indexBuffer[mesh.m_IdxOffset + (idx * 3)]];
-            const VertexInput& vi1 = vertexBuffer[indexBuffer[mesh.m_IdxOffset + (idx * 3 + 1)]];
-            const VertexInput& vi2 = vertexBuffer[indexBuffer[mesh.m_IdxOffset + (idx * 3 + 2)]];
+        if (result > 0.0f) return true;
+        else if (result < 0.0f) return false;
+
+        // Gradient of the (flipped) edge function, which is exactly negated for the opposite edge as well
+        float dx = b.y - a.y;
+        float dy = a.x - b.x;
+
+        if (dx > 0.f) return true;
+        else if (dx < 0.0f) return false;
+
+        if ((dx == 0.0f) && (dy < 0.0f)) return false;
+        else return true;
+    }
 
-            // To collect VS payload
-            FragmentInput fi0;
-            FragmentInput fi1;
-            FragmentInput fi2;
+    // Project a vertex given in homogeneous raster space if it's in front of the camera. Returns whether it ended up within the guard band.
+    bool ProjectToGuardBand(const glm::vec4& vHomogen, glm::vec2& p)
+    {
+        if (vHomogen.w <= 0.0f)
+            return false;
 
-            // Invoke VS for each vertex of the triangle to transform them from object-space to clip-space (-w, w)
-            glm::vec4 v0Clip = VS(vi0, MVP, fi0);
-            glm::vec4 v1Clip = VS(vi1, MVP, fi1);
-            glm::vec4 v2Clip = VS(vi2, MVP, fi2);
+        p = glm::vec2(vHomogen.x, vHomogen.y) / vHomogen.w;
+        return (p.x >= -g_GuardBandSize) && (p.x <= (g_scWidth + g_GuardBandSize)) && (p.y >= -g_GuardBandSize) && (p.y <= (g_scHeight + g_GuardBandSize));
+    }
 
-            // Apply viewport transformation
-            // Notice that we haven't applied homogeneous division and are still utilizing homogeneous coordinates
-            glm::vec4 v0Homogen = TO_RASTER(v0Clip);
-            glm::vec4 v1Homogen = TO_RASTER(v1Clip);
-            glm::vec4 v2Homogen = TO_RASTER(v2Clip);
+    // Rasterize a single triangle given in clip-space and invoke fragmentFn(x, y, z, b) at every covered sample, where b holds perspective-correct
+    // barycentric coordinates of the sample. Depth test is left to fragmentFn, which returns true to stop rasterizing the triangle altogether.
+    // All draws go through here so that every pass (shading, depth-only and occlusion queries) classifies triangles and computes z identically.
+    template<typename FragmentFn>
+    void RasterizeTriangle(const glm::vec4& v0Clip, const glm::vec4& v1Clip, const glm::vec4& v2Clip, FragmentFn&& fragmentFn)
+    {
+        // Apply viewport transformation
+        // Notice that we haven't applied homogeneous division and are still utilizing homogeneous coordinates
+        glm::vec4 v0Homogen = TO_RASTER(v0Clip);
+        glm::vec4 v1Homogen = TO_RASTER(v1Clip);
+        glm::vec4 v2Homogen = TO_RASTER(v2Clip);
+
+        // Triangles with all vertices in front of the camera can be projected and bounded in screen-space
+        const bool projectable = (v0Clip.w > 0.0f) && (v1Clip.w > 0.0f) && (v2Clip.w > 0.0f);
+
+        // Only edges between vertices projected within the guard band are evaluated with 2D edge functions. This only depends on each vertex
+        // on its own, so that triangles sharing an edge always agree on how to evaluate it.
+        glm::vec2 p0, p1, p2;
+        const bool inGuardBand0 = ProjectToGuardBand(v0Homogen, p0);
+        const bool inGuardBand1 = ProjectToGuardBand(v1Homogen, p1);
+        const bool inGuardBand2 = ProjectToGuardBand(v2Homogen, p2);
+
+        int32_t minX = 0, minY = 0;
+        int32_t maxX = g_scWidth - 1, maxY = g_scHeight - 1;
+
+        if (projectable)
+        {
+            // Candidate pixels are the ones whose sample centers (x + 0.5, y + 0.5) fall into the bounds
+            glm::vec2 boundsMin = glm::min(p0, glm::min(p1, p2));
+            glm::vec2 boundsMax = glm::max(p0, glm::max(p1, p2));
+
+            // Clamp to the screen before converting, as vertices close to w = 0 project way beyond what int32_t can hold.
+            // Bounds entirely off one side of the screen still end up with min > max.
+            minX = static_cast<int32_t>(glm::clamp(glm::ceil(boundsMin.x - 0.5f), 0.0f, static_cast<float>(g_scWidth)));
+            minY = static_cast<int32_t>(glm::clamp(glm::ceil(boundsMin.y - 0.5f), 0.0f, static_cast<float>(g_scHeight)));
+            maxX = static_cast<int32_t>(glm::clamp(glm::floor(boundsMax.x - 0.5f), -1.0f, static_cast<float>(g_scWidth - 1)));
+            maxY = static_cast<int32_t>(glm::clamp(glm::floor(boundsMax.y - 0.5f), -1.0f, static_cast<float>(g_scHeight - 1)));
+
+            // Sub-pixel or off-screen triangles which miss all sample centers are rejected before any setup
+            if ((minX > maxX) || (minY > maxY))
+            {
+                g_RasterStats.m_NumNoSamples++;
+                return;
+            }
+        }
 
-            // Base vertex matrix
-            glm::mat3 M =
+        // Only triangles entirely within the guard band are classified and culled in 2D
+        const bool inGuardBand = inGuardBand0 && inGuardBand1 && inGuardBand2;
+        if (inGuardBand)
+        {
+            // Signed area in raster space has the same sign as det(M) below when all w are positive,
+            // so degenerate and back-facing triangles are rejected without any matrix math
+            float area = ((p1.x - p0.x) * (p2.y - p0.y)) - ((p2.x - p0.x) * (p1.y - p0.y));
+            if (area >= 0.0f)
             {
-                // Notice that glm is itself column-major)
-                { v0Homogen.x, v1Homogen.x, v2Homogen.x},
-                { v0Homogen.y, v1Homogen.y, v2Homogen.y},
-                { v0Homogen.w, v1Homogen.w, v2Homogen.w},
-            };
+                g_RasterStats.m_NumCulled++;
+                return;
+            }
+
+            // Small triangles only test their few candidate pixels and derive everything from 2D barycentrics of covered samples,
+            // skipping the vertex matrix inverse and interpolation setup altogether
+            if ((static_cast<uint32_t>(maxX - minX + 1) * static_cast<uint32_t>(maxY - minY + 1)) <= g_SmallTriangleMaxSamples)
+            {
+                g_RasterStats.m_NumSmall++;
+
+                const float oneOverArea = 1.0f / area;
+                const glm::vec3 oneOverWs(1.0f / v0Clip.w, 1.0f / v1Clip.w, 1.0f / v2Clip.w);
+                const glm::vec3 zs(v0Clip.z, v1Clip.z, v2Clip.z);
+
+                for (auto y = minY; y <= maxY; y++)
+                {
+                    for (auto x = minX; x <= maxX; x++)
+                    {
+                        glm::vec2 sample = { x + 0.5f, y + 0.5f };
+
+                        bool inside0 = EvaluateEdgeFunction2D(p1, p2, sample);
+                        bool inside1 = EvaluateEdgeFunction2D(p2, p0, sample);
+                        bool inside2 = EvaluateEdgeFunction2D(p0, p1, sample);
+
+                        if (inside0 && inside1 && inside2)
+                        {
+                            // Screen-space barycentrics, which are then made perspective-correct by weighting with 1/w of each vertex
+                            glm::vec3 l = glm::vec3(EdgeFunction2D(p1, p2, sample), EdgeFunction2D(p2, p0, sample), EdgeFunction2D(p0, p1, sample)) * oneOverArea;
+                            glm::vec3 lOverW = l * oneOverWs;
+
+                            float w = 1.f / (lOverW.x + lOverW.y + lOverW.z);
+                            glm::vec3 b = lOverW * w;
+
+                            float z = glm::dot(b, zs);
+
+                            if (fragmentFn(x, y, z, b))
+                                return;
+                        }
+                    }
+                }
+
+                return;
+            }
+        }
 
-            // Singular vertex matrix (det(M) == 0.0) means that the triangle has zero area,
-            // which in turn means that it's a degenerate triangle which should not be rendered anyways,
-            // whereas (det(M) > 0) implies a back-facing triangle so we're going to skip such primitives
+        // Base vertex matrix
+        glm::mat3 M =
+        {
+            // Notice that glm is itself column-major)
+            { v0Homogen.x, v1Homogen.x, v2Homogen.x},
+            { v0Homogen.y, v1Homogen.y, v2Homogen.y},
+            { v0Homogen.w, v1Homogen.w, v2Homogen.w},
+        };
+
+        // Singular vertex matrix (det(M) == 0.0) means that the triangle has zero area,
+        // which in turn means that it's a degenerate triangle which should not be rendered anyways,
+        // whereas (det(M) > 0) implies a back-facing triangle so we're going to skip such primitives.
+        // Triangles within the guard band have been culled by their area already.
+        if (!inGuardBand)
+        {
             float det = glm::determinant(M);
             if (det >= 0.0f)
-                continue;
+            {
+                g_RasterStats.m_NumCulled++;
+                return;
+            }
+        }
 
-            // Compute the inverse of vertex matrix to use it for setting up edge & constant functions
-            M = inverse(M);
+        g_RasterStats.m_NumLarge++;
 
-            // Set up edge functions based on the vertex matrix
-            // We also apply some scaling to edge functions to be more robust.
-            // This is fine, as we are working with homogeneous coordinates and do not disturb the sign of these functions.
-            glm::vec3 E0 = M[0] / (glm::abs(M[0].x) + glm::abs(M[0].y));
-            glm::vec3 E1 = M[1] / (glm::abs(M[1].x) + glm::abs(M[1].y));
-            glm::vec3 E2 = M[2] / (glm::abs(M[2].x) + glm::abs(M[2].y));
+        // Compute the inverse of vertex matrix to use it for setting up constant functions
+        M = inverse(M);
 
-            // Calculate constant function to interpolate 1/w
-            glm::vec3 C = M * glm::vec3(1, 1, 1);
+        // Each edge is evaluated the same way by both triangles sharing it, as the choice only depends on its own two vertices: 2D edge functions
+        // within the guard band, homogeneous ones otherwise. Homogeneous edge functions are cross products of the edge's vertices, i.e. the columns of
+        // the inverse vertex matrix scaled by -det(M), and as (a x b) is the exact negation of (b x a) in floating-point, shared edges stay watertight.
+        const bool edge2D0 = inGuardBand1 && inGuardBand2;
+        const bool edge2D1 = inGuardBand2 && inGuardBand0;
+        const bool edge2D2 = inGuardBand0 && inGuardBand1;
 
-            // Calculate z interpolation vector
-            glm::vec3 Z = M * glm::vec3(v0Clip.z, v1Clip.z, v2Clip.z);
+        const glm::vec3 h0(v0Homogen.x, v0Homogen.y, v0Homogen.w);
+        const glm::vec3 h1(v1Homogen.x, v1Homogen.y, v1Homogen.w);
+        const glm::vec3 h2(v2Homogen.x, v2Homogen.y, v2Homogen.w);
 
-            // Calculate normal interpolation vector
-            glm::vec3 PNX = M * glm::vec3(fi0.Normal.x, fi1.Normal.x, fi2.Normal.x);
-            glm::vec3 PNY = M * glm::vec3(fi0.Normal.y, fi1.Normal.y, fi2.Normal.y);
-            glm::vec3 PNZ = M * glm::vec3(fi0.Normal.z, fi1.Normal.z, fi2.Normal.z);
+        const glm::vec3 E0 = glm::cross(h2, h1);
+        const glm::vec3 E1 = glm::cross(h0, h2);
+        const glm::vec3 E2 = glm::cross(h1, h0);
 
-            // Calculate UV interpolation vector
-            glm::vec3 PUVS = M * glm::vec3(fi0.TexCoords.s, fi1.TexCoords.s, fi2.TexCoords.s);
-            glm::vec3 PUVT = M * glm::vec3(fi0.TexCoords.t, fi1.TexCoords.t, fi2.TexCoords.t);
+        const glm::vec3 zs(v0Clip.z, v1Clip.z, v2Clip.z);
 
-            // Start rasterizing by looping over pixels to output a per-pixel color
-            for (auto y = 0; y < g_scHeight; y++)
+        // Start rasterizing by looping over candidate pixels, which is the whole screen if triangle couldn't be projected.
+        // Bounds of projected triangles beyond the guard band are imprecise far off-screen, but still hold the whole triangle once clamped to the screen.
+        for (auto y = minY; y <= maxY; y++)
+        {
+            for (auto x = minX; x <= maxX; x++)
             {
-                for (auto x = 0; x < g_scWidth; x++)
-                {
-                    // Sample location at the center of each pixel
-                    glm::vec2 sample = { x + 0.5f, y + 0.5f };
+                // Sample location at the center of each pixel
+                glm::vec2 sample = { x + 0.5f, y + 0.5f };
 
-                    // Evaluate edge functions at current fragment
-                    bool inside0 = EvaluateEdgeFunction(E0, sample);
-                    bool inside1 = EvaluateEdgeFunction(E1, sample);
-                    bool inside2 = EvaluateEdgeFunction(E2, sample);
+                // Evaluate edge functions at current fragment
+                bool inside0 = edge2D0 ? EvaluateEdgeFunction2D(p1, p2, sample) : EvaluateEdgeFunction(E0, sample);
+                bool inside1 = edge2D1 ? EvaluateEdgeFunction2D(p2, p0, sample) : EvaluateEdgeFunction(E1, sample);
+                bool inside2 = edge2D2 ? EvaluateEdgeFunction2D(p0, p1, sample) : EvaluateEdgeFunction(E2, sample);
 
-                    // If sample is "inside" of all three half-spaces bounded by the three edges of the triangle, it's 'on' the triangle
-                    if (inside0 && inside1 && inside2)
+                // If sample is "inside" of all three half-spaces bounded by the three edges of the triangle, it's 'on' the triangle
+                if (inside0 && inside1 && inside2)
+                {
+                    // Columns of the inverse vertex matrix interpolate each vertex' barycentric coordinate divided by w
+                    glm::vec3 bOverW =
                     {
-                        // Interpolate 1/w at current fragment
-                        float oneOverW = (C.x * sample.x) + (C.y * sample.y) + C.z;
+                        (M[0].x * sample.x) + (M[0].y * sample.y) + M[0].z,
+                        (M[1].x * sample.x) + (M[1].y * sample.y) + M[1].z,
+                        (M[2].x * sample.x) + (M[2].y * sample.y) + M[2].z,
+                    };
 
-                        // w = 1/(1/w)
-                        float w = 1.f / oneOverW;
+                    // Interpolate 1/w at current fragment, w = 1/(1/w)
+                    float w = 1.f / (bOverW.x + bOverW.y + bOverW.z);
 
-                        // Interpolate z that will be used for depth test
-                        float zOverW = (Z.x * sample.x) + (Z.y * sample.y) + Z.z;
-                        float z = zOverW * w;
+                    // {b0/w, b1/w, b2/w} * w -> {b0, b1, b2}
+                    glm::vec3 b = bOverW * w;
 
-                        if (z <= depthBuffer[x + y * g_scWidth])
-                        {
-                            // Depth test passed; update depth buffer value
-                            depthBuffer[x + y * g_scWidth] = z;
+                    // Interpolate z that will be used for depth test
+                    float z = glm::dot(b, zs);
+
+                    if (fragmentFn(x, y, z, b))
+                        return;
+                }
+            }
+        }
+    }
+
+    // Per-draw state to cull meshlets with, all in object-space
+    struct MeshletCulling
+    {
+        // Frustum planes pointing inwards, normalized
+        glm::vec4   m_Planes[6];
+
+        // Camera position
+        glm::vec3   m_Eye;
+    };
 
-                            // Interpolate normal
-                            float nxOverW = (PNX.x * sample.x) + (PNX.y * sample.y) + PNX.z;
-                            float nyOverW = (PNY.x * sample.x) + (PNY.y * sample.y) + PNY.z;
-                            float nzOverW = (PNZ.x * sample.x) + (PNZ.y * sample.y) + PNZ.z;
+    MeshletCulling SetupMeshletCulling(const glm::mat4& MVP)
+    {
+        MeshletCulling culling;
 
-                            // Interpolate texture coordinates
-                            float uOverW = (PUVS.x * sample.x) + (PUVS.y * sample.y) + PUVS.z;
-                            float vOverW = (PUVT.x * sample.x) + (PUVT.y * sample.y) + PUVT.z;
+        // Extract frustum planes from rows of MVP, keeping in mind that depth is in [0, w]
+        glm::vec4 row0(MVP[0][0], MVP[1][0], MVP[2][0], MVP[3][0]);
+        glm::vec4 row1(MVP[0][1], MVP[1][1], MVP[2][1], MVP[3][1]);
+        glm::vec4 row2(MVP[0][2], MVP[1][2], MVP[2][2], MVP[3][2]);
+        glm::vec4 row3(MVP[0][3], MVP[1][3], MVP[2][3], MVP[3][3]);
 
-                            // Final vertex attributes to be passed to FS
-                            glm::vec3 normal = glm::vec3(nxOverW, nyOverW, nzOverW) * w; // {nx/w, ny/w, nz/w} * w -> {nx, ny, nz}
-                            glm::vec2 texCoords = glm::vec2(uOverW, vOverW) * w; // {u/w, v/w} * w -> {u, v}
+        culling.m_Planes[0] = row3 + row0; // Left
+        culling.m_Planes[1] = row3 - row0; // Right
+        culling.m_Planes[2] = row3 + row1; // Bottom
+        culling.m_Planes[3] = row3 - row1; // Top
+        culling.m_Planes[4] = row2;        // Near
+        culling.m_Planes[5] = row3 - row2; // Far
 
-                            // Pass interpolated normal & texture coordinates to FS
-                            FragmentInput fsInput = { normal, texCoords };
+        for (glm::vec4& plane : culling.m_Planes)
+            plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
 
-                            // Invoke fragment shader to output a color for each fragment
-                            glm::vec3 outputColor = FS(fsInput, pTexture);
+        // Camera position is the only point that projects to w = 0 on all of x, y and w, i.e. (0, 0, z, 0) in clip-space for perspective projections
+        glm::vec4 eye = glm::inverse(MVP) * glm::vec4(0, 0, 1, 0);
+        culling.m_Eye = glm::vec3(eye.x, eye.y, eye.z) / eye.w;
 
-                            // Write new color at this fragment
-                            frameBuffer[x + y * g_scWidth] = outputColor;
-                        }
+        return culling;
+    }
+
+    // Return true if meshlet is either entirely outside of the frustum or entirely back-facing
+    bool CullMeshlet(const Meshlet& meshlet, const MeshletCulling& culling)
+    {
+        for (const glm::vec4& plane : culling.m_Planes)
+        {
+            if ((glm::dot(glm::vec3(plane.x, plane.y, plane.z), meshlet.m_Center) + plane.w) < -meshlet.m_Radius)
+            {
+                g_RasterStats.m_NumMeshletsFrustumCulled++;
+                return true;
+            }
+        }
+
+        if (glm::dot(glm::normalize(meshlet.m_ConeApex - culling.m_Eye), meshlet.m_ConeAxis) > meshlet.m_ConeCutoff)
+        {
+            g_RasterStats.m_NumMeshletsConeCulled++;
+            return true;
+        }
+
+        g_RasterStats.m_NumMeshletsDrawn++;
+        return false;
+    }
+
+    void DrawIndexed(std::vector<glm::vec3>& frameBuffer, std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, Mesh& mesh, glm::mat4& MVP, TextureCache& textureCache, MaterialHandle material)
+    {
+        // Texture is only acquired the first time FS needs it, so occluded meshes never have their textures streamed in
+        Texture* pTexture = nullptr;
+
+        const MeshletCulling culling = SetupMeshletCulling(MVP);
+
+        // Loop over meshlets in a given mesh, whose triangles are in the same order as in the index buffer
+        for (uint32_t m = 0; m < mesh.m_MeshletCount; m++)
+        {
+            const Meshlet& meshlet = meshletData.m_Meshlets[mesh.m_MeshletOffset + m];
+
+            // Reject whole meshlets before any VS invocations
+            if (CullMeshlet(meshlet, culling))
+                continue;
+
+            // Invoke VS once for each unique vertex of the meshlet to transform them from object-space to clip-space (-w, w)
+            glm::vec4 clipPositions[g_MeshletMaxVertices];
+            FragmentInput fragmentInputs[g_MeshletMaxVertices];
+
+            for (uint32_t v = 0; v < meshlet.m_VertexCount; v++)
+                clipPositions[v] = VS(vertexBuffer[meshletData.m_Vertices[meshlet.m_VertexOffset + v]], MVP, fragmentInputs[v]);
+
+            // Loop over triangles in the meshlet and rasterize them
+            for (uint32_t idx = 0; idx < meshlet.m_TriangleCount; idx++)
+            {
+                const uint8_t* pTriangle = &meshletData.m_Triangles[meshlet.m_TriangleOffset + idx * 3];
+
+                const FragmentInput& fi0 = fragmentInputs[pTriangle[0]];
+                const FragmentInput& fi1 = fragmentInputs[pTriangle[1]];
+                const FragmentInput& fi2 = fragmentInputs[pTriangle[2]];
+
+                RasterizeTriangle(clipPositions[pTriangle[0]], clipPositions[pTriangle[1]], clipPositions[pTriangle[2]], [&](int32_t x, int32_t y, float z, const glm::vec3& b)
+                {
+                    if (z <= depthBuffer[x + y * g_scWidth])
+                    {
+                        // Depth test passed; update depth buffer value
+                        depthBuffer[x + y * g_scWidth] = z;
+
+                        // Interpolate normal & texture coordinates with perspective-correct barycentrics
+                        glm::vec3 normal = (fi0.Normal * b.x) + (fi1.Normal * b.y) + (fi2.Normal * b.z);
+                        glm::vec2 texCoords = (fi0.TexCoords * b.x) + (fi1.TexCoords * b.y) + (fi2.TexCoords * b.z);
+
+                        // Pass interpolated normal & texture coordinates to FS
+                        FragmentInput fsInput = { normal, texCoords };
+
+                        if (pTexture == nullptr)
+                            pTexture = textureCache.Acquire(material);
+
+                        // Invoke fragment shader to output a color for each fragment
+                        glm::vec3 outputColor = FS(fsInput, pTexture);
+
+                        // Write new color at this fragment
+                        frameBuffer[x + y * g_scWidth] = outputColor;
                     }
-                }
+
+                    return false;
+                });
+            }
+        }
+    }
+
+    // Rasterize a single triangle in clip-space against depth buffer only, skipping attribute interpolation and FS entirely.
+    // Depth buffer is updated only if writeDepth is set, and the number of samples passing depth test is returned.
+    // If earlyOut is set, rasterization stops as soon as the first sample passes.
+    uint32_t RasterizeDepth(std::vector<float>& depthBuffer, const glm::vec4& v0Clip, const glm::vec4& v1Clip, const glm::vec4& v2Clip, bool writeDepth, bool earlyOut)
+    {
+        uint32_t numPassed = 0u;
+
+        RasterizeTriangle(v0Clip, v1Clip, v2Clip, [&](int32_t x, int32_t y, float z, const glm::vec3&)
+        {
+            if (z <= depthBuffer[x + y * g_scWidth])
+            {
+                if (writeDepth)
+                    depthBuffer[x + y * g_scWidth] = z;
+
+                numPassed++;
+                return earlyOut;
+            }
+
+            return false;
+        });
+
+        return numPassed;
+    }
+
+    // Depth-only variant of DrawIndexed() for occluder pre-passes
+    void DrawIndexedDepthOnly(std::vector<float>& depthBuffer, std::vector<VertexInput>& vertexBuffer, MeshletData& meshletData, Mesh& mesh, glm::mat4& MVP)
+    {
+        const MeshletCulling culling = SetupMeshletCulling(MVP);
+
+        for (uint32_t m = 0; m < mesh.m_MeshletCount; m++)
+        {
+            const Meshlet& meshlet = meshletData.m_Meshlets[mesh.m_MeshletOffset + m];
+
+            // Cull exactly the same meshlets as DrawIndexed() does
+            if (CullMeshlet(meshlet, culling))
+                continue;
+
+            glm::vec4 clipPositions[g_MeshletMaxVertices];
+            for (uint32_t v = 0; v < meshlet.m_VertexCount; v++)
+                clipPositions[v] = VSDepthOnly(vertexBuffer[meshletData.m_Vertices[meshlet.m_VertexOffset + v]], MVP);
+
+            for (uint32_t idx = 0; idx < meshlet.m_TriangleCount; idx++)
+            {
+                const uint8_t* pTriangle = &meshletData.m_Triangles[meshlet.m_TriangleOffset + idx * 3];
+
+                RasterizeDepth(depthBuffer, clipPositions[pTriangle[0]], clipPositions[pTriangle[1]], clipPositions[pTriangle[2]], true /*writeDepth*/, false /*earlyOut*/);
             }
         }
     }
+
+    // Software occlusion query: rasterize front faces of an object-space bounding box against the current depth buffer, without updating it,
+    // and return the number of visible samples. If earlyOut is set, it stops counting as soon as any sample passes (i.e. result is 0 or 1).
+    uint32_t OcclusionQuery(std::vector<float>& depthBuffer, const glm::vec3& bounds0, const glm::vec3& bounds1, const glm::mat4& MVP, bool earlyOut)
+    {
+        // Inflate the box a bit to stay conservative, as bounds of flat meshes (e.g. walls) would coincide with the mesh itself
+        // and rounding errors could then make it fail depth test against its own depth
+        glm::vec3 extent = bounds1 - bounds0;
+        glm::vec3 padding = glm::vec3(std::max(extent.x, std::max(extent.y, extent.z)) * 0.01f + 1e-4f);
+
+        const glm::vec3 boundsMin = bounds0 - padding;
+        const glm::vec3 boundsMax = bounds1 + padding;
+
+        // Box corners and counter-clockwise triangles of its 6 faces, as used for the cube in Part II
+        const glm::vec3 corners[] =
+        {
+            { boundsMax.x, boundsMin.y, boundsMin.z },
+            { boundsMax.x, boundsMin.y, boundsMax.z },
+            { boundsMin.x, boundsMin.y, boundsMax.z },
+            { boundsMin.x, boundsMin.y, boundsMin.z },
+            { boundsMax.x, boundsMax.y, boundsMin.z },
+            { boundsMax.x, boundsMax.y, boundsMax.z },
+            { boundsMin.x, boundsMax.y, boundsMax.z },
+            { boundsMin.x, boundsMax.y, boundsMin.z },
+        };
+
+        const uint32_t indices[] =
+        {
+            1,3,0, 7,5,4, 4,1,0, 5,2,1, 2,7,3, 0,7,4, 1,2,3, 7,6,5, 4,5,1, 5,6,2, 2,6,7, 0,3,7
+        };
+
+        glm::vec4 cornersClip[8];
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            cornersClip[i] = MVP * glm::vec4(corners[i], 1.0f);
+
+            // There's no clipping, so treat boxes crossing the camera plane (e.g. camera is inside the box) as visible
+            if (cornersClip[i].w <= 0.0f)
+                return 1u;
+        }
+
+        uint32_t numPassed = 0u;
+        for (uint32_t idx = 0; idx < 12; idx++)
+        {
+            numPassed += RasterizeDepth(depthBuffer, cornersClip[indices[idx * 3]], cornersClip[indices[idx * 3 + 1]], cornersClip[indices[idx * 3 + 2]], false /*writeDepth*/, earlyOut);
+
+            if (earlyOut && (numPassed > 0u))
+                break;
+        }
+
+        return numPassed;
+    }
 }
\ No newline at end of file
@@ -1,5 +1,16 @@
 #include "pch.h"
 
+// Let stb_image allocate through counted functions too, so that decoding textures shows up in allocation counters
+namespace partIII
+{
+    void* CountedMalloc(size_t size);
+    void* CountedRealloc(void* p, size_t size);
+    void CountedFree(void* p);
+}
+
+#define STBI_MALLOC(size)       partIII::CountedMalloc(size)
+#define STBI_REALLOC(p, size)   partIII::CountedRealloc(p, size)
+#define STBI_FREE(p)            partIII::CountedFree(p)
 #define STB_IMAGE_IMPLEMENTATION
 #include "../deps/stb/stb_image.h"
 
@@ -10,8 +21,64 @@
 #include "../Go3D.h"
 #include "../GoWild.h"
 
-int main()
+// Replace global operator new & delete to count every heap allocation made, see partIII::AllocationCounters
+void* operator new(size_t size)
+{
+    partIII::g_AllocCounters.m_NumAllocs++;
+    partIII::g_AllocCounters.m_NumBytes += size;
+
+    // malloc(0) may return null, whereas operator new must return a unique pointer for zero-sized requests
+    if (void* p = malloc((size > 0) ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
 {
+    operator delete(p);
+}
+
+int main(int argc, char* argv[])
+{
+    // Usage: RasterizationInOneWeekend [--processes N] [--verify-compositing]
+    partIII::RenderSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--processes") == 0) && (i + 1 < argc))
+            settings.m_NumRenderProcesses = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        else if (strcmp(argv[i], "--verify-compositing") == 0)
+            settings.m_VerifyCompositing = true;
+        else
+            printf("WARNING: Ignoring unknown argument %s\n", argv[i]);
+    }
+
+    if (settings.m_VerifyCompositing && (settings.m_NumRenderProcesses <= 1))
+    {
+        printf("ERROR: --verify-compositing needs --processes greater than 1, as there's nothing to composite otherwise\n");
+        return 1;
+    }
+
     // Part I: Hello, Triangle!
     partI::HelloTriangle();
 
@@ -19,5 +86,5 @@ int main()
     partII::Go3D();
 
     // Part III: Go Wild!
-    partIII::GoWild();
+    return partIII::GoWild(settings) ? 0 : 1;
 }
\ No newline at end of file
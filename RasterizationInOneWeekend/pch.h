@@ -2,9 +2,43 @@
 
 #include <iostream>
 #include <vector>
+#include <map>
+#include <string>
 #include <cassert>
+#include <cerrno>
+#include <cfloat>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <chrono>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_MSC_VER)
+// fopen_s() is only provided by MSVC's CRT, so map it onto plain fopen() elsewhere
+inline int fopen_s(FILE** ppFile, const char* pFileName, const char* pMode)
+{
+    *ppFile = fopen(pFileName, pMode);
+    return (*ppFile != nullptr) ? 0 : errno;
+}
+#endif
 
 #define GLM_FORCE_INLINE
 #define GLM_FORCE_RADIANS